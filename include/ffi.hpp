@@ -0,0 +1,479 @@
+/* -----------------------------------------------------------------*-C++-*-
+   ffi.hpp - C++17 helpers for libffi.
+
+   Permission is hereby granted, free of charge, to any person
+   obtaining a copy of this software and associated documentation
+   files (the ``Software''), to deal in the Software without
+   restriction, including without limitation the rights to use, copy,
+   modify, merge, publish, distribute, sublicense, and/or sell copies
+   of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be
+   included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED ``AS IS'', WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+   NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+
+   ----------------------------------------------------------------------- */
+
+/* -------------------------------------------------------------------
+   This header derives ffi_type objects and prepared cifs from C++
+   types at compile time.  Primitive types map onto the ones exported
+   by libffi; structures are described by specializing ffi::members:
+
+     struct Foo { int a; double b; };
+     template <> struct ffi::members<Foo> : ffi::member_list<int, double> {};
+
+     ffi::function<int (double, Foo)> f (some_function);
+     int r = f (1.0, Foo { 2, 3.0 });
+
+   Element tables are constant-initialized, and the size and alignment
+   of structures and arrays are taken from the compiler, so nothing is
+   assembled at run time.  ffi::check_layout can be used to verify a
+   member list against libffi's own layout rules.
+   ------------------------------------------------------------------- */
+
+#ifndef LIBFFI_HPP
+#define LIBFFI_HPP
+
+#include <ffi.h>
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/* The address of a variable imported from a DLL is not a constant
+   expression.  */
+#if defined _MSC_VER && !defined FFI_BUILDING
+# define FFI_HPP_CONSTEXPR
+#else
+# define FFI_HPP_CONSTEXPR constexpr
+#endif
+
+namespace ffi {
+
+/* Specialize for each C++ type that should map onto an ffi_type.  */
+template <typename T, typename Enable = void>
+struct type_traits;
+
+/* Specialize for each structure, deriving from member_list.  */
+template <typename T>
+struct members;
+
+template <typename T>
+FFI_HPP_CONSTEXPR ffi_type *type_of () noexcept
+{
+  return type_traits<T>::get ();
+}
+
+template <typename... M>
+struct member_list
+{
+  static_assert (sizeof... (M) > 0, "structures need at least one member");
+  static inline ffi_type *elements[] = { type_of<M> ()..., nullptr };
+};
+
+namespace detail {
+
+template <std::size_t Size, bool Signed>
+struct integer;
+
+#define FFI_HPP_INTEGER(SIZE, SIGNED, TYPE)				\
+  template <> struct integer<SIZE, SIGNED>				\
+  {									\
+    static FFI_HPP_CONSTEXPR ffi_type *get () noexcept { return &TYPE; } \
+  }
+
+FFI_HPP_INTEGER (1, false, ffi_type_uint8);
+FFI_HPP_INTEGER (1, true, ffi_type_sint8);
+FFI_HPP_INTEGER (2, false, ffi_type_uint16);
+FFI_HPP_INTEGER (2, true, ffi_type_sint16);
+FFI_HPP_INTEGER (4, false, ffi_type_uint32);
+FFI_HPP_INTEGER (4, true, ffi_type_sint32);
+FFI_HPP_INTEGER (8, false, ffi_type_uint64);
+FFI_HPP_INTEGER (8, true, ffi_type_sint64);
+#ifdef FFI_TARGET_HAS_INT128_TYPE
+FFI_HPP_INTEGER (16, false, ffi_type_uint128);
+FFI_HPP_INTEGER (16, true, ffi_type_sint128);
+#endif
+
+#undef FFI_HPP_INTEGER
+
+template <typename T, typename I>
+struct array_elements;
+
+template <typename T, std::size_t... I>
+struct array_elements<T, std::index_sequence<I...> >
+{
+  static inline ffi_type *elements[] = { ((void) I, type_of<T> ())...,
+					 nullptr };
+};
+
+} // namespace detail
+
+#define FFI_HPP_PRIMITIVE(CTYPE, TYPE)					\
+  template <> struct type_traits<CTYPE>					\
+  {									\
+    static FFI_HPP_CONSTEXPR ffi_type *get () noexcept { return &TYPE; } \
+  }
+
+FFI_HPP_PRIMITIVE (void, ffi_type_void);
+FFI_HPP_PRIMITIVE (float, ffi_type_float);
+FFI_HPP_PRIMITIVE (double, ffi_type_double);
+FFI_HPP_PRIMITIVE (long double, ffi_type_longdouble);
+
+#undef FFI_HPP_PRIMITIVE
+
+template <typename T>
+struct type_traits<T, std::enable_if_t<std::is_integral_v<T> > >
+  : detail::integer<sizeof (T), std::is_signed_v<T> >
+{
+};
+
+template <typename T>
+struct type_traits<T, std::enable_if_t<std::is_enum_v<T> > >
+  : type_traits<std::underlying_type_t<T> >
+{
+};
+
+template <typename T>
+struct type_traits<T, std::enable_if_t<std::is_pointer_v<T> > >
+{
+  static FFI_HPP_CONSTEXPR ffi_type *get () noexcept
+  {
+    return &ffi_type_pointer;
+  }
+};
+
+template <typename T>
+struct type_traits<T, std::enable_if_t<std::is_class_v<T> > >
+{
+  static_assert (std::is_standard_layout_v<T>
+		 && std::is_trivially_copyable_v<T>,
+		 "only plain structures can be described to libffi");
+
+  static inline ffi_type type = { sizeof (T), alignof (T), FFI_TYPE_STRUCT,
+				  members<T>::elements };
+
+  static FFI_HPP_CONSTEXPR ffi_type *get () noexcept { return &type; }
+};
+
+/* Arrays can only appear as structure members.  Where the target has
+   no FFI_TYPE_ARRAY, they are spelled out as a structure of N copies
+   of the element.  */
+template <typename T, std::size_t N>
+struct type_traits<T[N]>
+{
+  static inline ffi_type type = {
+    sizeof (T[N]), alignof (T),
+#ifdef FFI_TARGET_HAS_ARRAY_TYPE
+    FFI_TYPE_ARRAY,
+    detail::array_elements<T, std::make_index_sequence<1> >::elements
+#else
+    FFI_TYPE_STRUCT,
+    detail::array_elements<T, std::make_index_sequence<N> >::elements
+#endif
+  };
+
+  static FFI_HPP_CONSTEXPR ffi_type *get () noexcept { return &type; }
+};
+
+/* Return true if libffi lays out T's member list the same way the
+   compiler laid out T.  */
+template <typename T>
+bool check_layout (ffi_abi abi = FFI_DEFAULT_ABI)
+{
+  ffi_type *t = type_of<T> ();
+  ffi_type scratch = { 0, 0, t->type, t->elements };
+
+  if (t->type != FFI_TYPE_STRUCT
+      || ffi_get_struct_offsets (abi, &scratch, nullptr) != FFI_OK)
+    return false;
+  return scratch.size == t->size && scratch.alignment == t->alignment;
+}
+
+namespace detail {
+
+template <ffi_abi Abi, typename R, typename... A>
+struct signature
+{
+  ffi_type *args[sizeof... (A) + 1] = { type_of<A> ()..., nullptr };
+  ffi_cif cif;
+  ffi_status status;
+
+  signature () noexcept
+  {
+    status = ffi_prep_cif (&cif, Abi, sizeof... (A), type_of<R> (), args);
+  }
+
+  static signature &instance () noexcept
+  {
+    static signature s;
+    return s;
+  }
+};
+
+} // namespace detail
+
+template <typename Sig, ffi_abi Abi = FFI_DEFAULT_ABI>
+class function;
+
+template <typename Sig, ffi_abi Abi = FFI_DEFAULT_ABI>
+class closure;
+
+/* A function with a signature known at compile time.  The cif is
+   prepared once per signature and ABI, on first use.  */
+template <typename R, typename... A, ffi_abi Abi>
+class function<R (A...), Abi>
+{
+public:
+  using pointer = R (*) (A...);
+
+  /* FN may be any function pointer, such as one declared with a
+     different calling convention for use with a non-default ABI.  */
+  template <typename F,
+	    typename = std::enable_if_t<std::is_function_v<F> > >
+  explicit function (F *fn) noexcept
+    : fn_ (reinterpret_cast<void (*) (void)> (fn)) {}
+
+  /* The prepared cif, or NULL if ffi_prep_cif failed.  */
+  static ffi_cif *cif () noexcept
+  {
+    auto &s = detail::signature<Abi, R, A...>::instance ();
+    return s.status == FFI_OK ? &s.cif : nullptr;
+  }
+
+  /* With the default ABI the compiler already knows how to make the
+     call, so the arguments need not be boxed for ffi_call.  */
+  R operator() (A... args) const
+  {
+    if constexpr (Abi == FFI_DEFAULT_ABI)
+      return reinterpret_cast<pointer> (fn_) (args...);
+    else
+      return call (args...);
+  }
+
+  /* Always go through ffi_call.  Aborts if the cif could not be
+     prepared.  */
+  R call (A... args) const
+  {
+    ffi_cif *c = cif ();
+    void *values[sizeof... (A) + 1] = {
+      const_cast<void *> (static_cast<const void *> (std::addressof (args)))...,
+      nullptr
+    };
+
+    if (c == nullptr)
+      std::abort ();
+
+    if constexpr (std::is_void_v<R>)
+      ffi_call (c, fn_, nullptr, values);
+    else if constexpr (std::is_integral_v<R> || std::is_enum_v<R>)
+      {
+	/* Small integers are widened to a full ffi_arg.  */
+	if constexpr (sizeof (R) < sizeof (ffi_arg))
+	  {
+	    ffi_arg r;
+	    ffi_call (c, fn_, &r, values);
+	    return static_cast<R> (r);
+	  }
+	else
+	  {
+	    R r;
+	    ffi_call (c, fn_, &r, values);
+	    return r;
+	  }
+      }
+    else
+      {
+	/* The return buffer must be at least as large as a register.  */
+	alignas (R) alignas (ffi_arg)
+	  unsigned char buf[sizeof (R) < sizeof (ffi_arg)
+			    ? sizeof (ffi_arg) : sizeof (R)];
+	R r;
+
+	ffi_call (c, fn_, buf, values);
+	std::memcpy (static_cast<void *> (&r), buf, sizeof (R));
+	return r;
+      }
+  }
+
+  void (*get () const noexcept) (void) { return fn_; }
+
+private:
+  void (*fn_) (void);
+};
+
+#if FFI_CLOSURES
+
+namespace detail {
+
+template <typename R, bool = std::is_enum_v<R> >
+struct integer_of
+{
+  using type = R;
+};
+
+template <typename R>
+struct integer_of<R, true>
+{
+  using type = std::underlying_type_t<R>;
+};
+
+/* Store a closure's result the way libffi expects it: integers
+   narrower than a register are widened to a full ffi_arg.  */
+template <typename R>
+void store_result (void *ret, R r) noexcept
+{
+  if constexpr ((std::is_integral_v<R> || std::is_enum_v<R>)
+		&& sizeof (R) < sizeof (ffi_arg))
+    {
+      if constexpr (std::is_signed_v<typename integer_of<R>::type>)
+	*static_cast<ffi_sarg *> (ret) = static_cast<ffi_sarg> (r);
+      else
+	*static_cast<ffi_arg *> (ret) = static_cast<ffi_arg> (r);
+    }
+  else
+    std::memcpy (ret, static_cast<const void *> (&r), sizeof (R));
+}
+
+} // namespace detail
+
+/* A closure with a signature known at compile time.  The callable is
+   stored in the same allocation as the ffi_closure, and the code that
+   unpacks the arguments is generated for each callable type.  */
+template <typename R, typename... A, ffi_abi Abi>
+class closure<R (A...), Abi>
+{
+public:
+  using pointer = R (*) (A...);
+
+  closure () noexcept = default;
+
+  /* Check the result with operator bool; it is false if the cif or
+     the closure could not be prepared.  */
+  template <typename F,
+	    typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>,
+							 closure> > >
+  explicit closure (F &&f)
+  {
+    using T = std::decay_t<F>;
+    static_assert (alignof (T) <= alignof (std::max_align_t),
+		   "over-aligned callables are not supported");
+
+    constexpr std::size_t off = (sizeof (ffi_closure) + alignof (T) - 1)
+				/ alignof (T) * alignof (T);
+    ffi_cif *c = function<R (A...), Abi>::cif ();
+    void *code;
+
+    if (c == nullptr)
+      return;
+    closure_ = static_cast<ffi_closure *> (ffi_closure_alloc (off + sizeof (T),
+							      &code));
+    if (closure_ == nullptr)
+      return;
+
+    T *obj = ::new (reinterpret_cast<char *> (closure_) + off)
+      T (std::forward<F> (f));
+    if (ffi_prep_closure_loc (closure_, c, &thunk<T>, obj, code) != FFI_OK)
+      {
+	obj->~T ();
+	ffi_closure_free (closure_);
+	closure_ = nullptr;
+	return;
+      }
+    code_ = code;
+    destroy_ = &destroy<T>;
+  }
+
+  closure (closure &&o) noexcept
+    : closure_ (o.closure_), code_ (o.code_), destroy_ (o.destroy_)
+  {
+    o.closure_ = nullptr;
+    o.code_ = nullptr;
+    o.destroy_ = nullptr;
+  }
+
+  closure &operator= (closure &&o) noexcept
+  {
+    if (this != &o)
+      {
+	reset ();
+	std::swap (closure_, o.closure_);
+	std::swap (code_, o.code_);
+	std::swap (destroy_, o.destroy_);
+      }
+    return *this;
+  }
+
+  closure (const closure &) = delete;
+  closure &operator= (const closure &) = delete;
+
+  ~closure () { reset (); }
+
+  explicit operator bool () const noexcept { return code_ != nullptr; }
+
+  /* The executable address, callable as a plain function pointer of
+     the closure's ABI.  */
+  pointer get () const noexcept { return reinterpret_cast<pointer> (code_); }
+  void *code () const noexcept { return code_; }
+
+  void reset () noexcept
+  {
+    if (closure_ != nullptr)
+      {
+	destroy_ (closure_->user_data);
+	ffi_closure_free (closure_);
+      }
+    closure_ = nullptr;
+    code_ = nullptr;
+    destroy_ = nullptr;
+  }
+
+private:
+  template <typename T>
+  static void destroy (void *obj) noexcept
+  {
+    static_cast<T *> (obj)->~T ();
+  }
+
+  template <typename T, std::size_t... I>
+  static void invoke (T &obj, void *ret, void **args,
+		      std::index_sequence<I...>)
+  {
+    if constexpr (std::is_void_v<R>)
+      obj (*static_cast<A *> (args[I])...);
+    else
+      detail::store_result<R> (ret, obj (*static_cast<A *> (args[I])...));
+  }
+
+  template <typename T>
+  static void thunk (ffi_cif *, void *ret, void **args, void *user_data)
+  {
+    invoke (*static_cast<T *> (user_data), ret, args,
+	    std::index_sequence_for<A...> ());
+  }
+
+  ffi_closure *closure_ = nullptr;
+  void *code_ = nullptr;
+  void (*destroy_) (void *) = nullptr;
+};
+
+#endif /* FFI_CLOSURES */
+
+} // namespace ffi
+
+#undef FFI_HPP_CONSTEXPR
+
+#endif /* LIBFFI_HPP */
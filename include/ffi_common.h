@@ -84,6 +84,15 @@ ffi_status ffi_prep_cif_machdep(ffi_cif *cif);
 ffi_status ffi_prep_cif_machdep_var(ffi_cif *cif,
 	 unsigned int nfixedargs, unsigned int ntotalargs);
 
+#ifdef FFI_TARGET_HAS_VARIADIC_TAIL
+/* Record the state after the fixed arguments of a variadic template,
+   and prepare the rest of a cif copied from one.  */
+ffi_status ffi_prep_var_template_machdep (ffi_var_template *tmpl) FFI_HIDDEN;
+ffi_status ffi_prep_cif_machdep_var_tail (ffi_cif *cif,
+					  const ffi_var_template *tmpl)
+  FFI_HIDDEN;
+#endif
+
 
 #if HAVE_LONG_DOUBLE_VARIANT
 /* Used to adjust size/alignment of ffi types.  */
@@ -142,6 +151,106 @@ typedef float FLOAT32;
 #define LIKELY(x)    __builtin_expect(!!(x),1)
 #define UNLIKELY(x)  __builtin_expect((x)!=0,0)
 
+/* Per-cif call statistics, see stats.c.  The probes compile away
+   entirely unless libffi was configured with --enable-stats, and
+   cost a single predictable branch when collection is switched off
+   at run time.  */
+#if FFI_STATS
+extern int ffi_stats_enabled FFI_HIDDEN;
+void ffi_stats_record (ffi_cif *cif, int closure, UINT64 ticks) FFI_HIDDEN;
+UINT64 ffi_stats_clock_generic (void) FFI_HIDDEN;
+
+static inline UINT64
+ffi_stats_clock (void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __builtin_ia32_rdtsc ();
+#elif defined(__aarch64__)
+  UINT64 t;
+  __asm__ __volatile__ ("mrs %0, cntvct_el0" : "=r" (t));
+  return t;
+#else
+  return ffi_stats_clock_generic ();
+#endif
+}
+
+#define FFI_STATS_START(t) \
+  UINT64 t = UNLIKELY (ffi_stats_enabled) ? ffi_stats_clock () : 0
+#define FFI_STATS_STOP(t, cif, closure)					\
+  do {									\
+    if (UNLIKELY (t))							\
+      ffi_stats_record ((cif), (closure), ffi_stats_clock () - (t));	\
+  } while (0)
+#else
+#define FFI_STATS_START(t)
+#define FFI_STATS_STOP(t, cif, closure) do { } while (0)
+#endif
+
+#if FFI_CLOSURES
+/* Make a freshly written trampoline executable, or queue it for the
+   next ffi_closure_sync; see closure_sync.c.  */
+void ffi_closure_flush_range (void *start, void *end) FFI_HIDDEN;
+
+/* A forwarding closure has ffi_forward_dispatch as its function.  A
+   target that recognises it may skip unpacking the arguments and
+   describe the incoming registers and stack in RAW instead, for
+   ffi_frame_forward_machdep to pass on as they are.  RAW[0] is null
+   when AVALUE holds the arguments.  */
+struct ffi_frame
+{
+  ffi_cif *cif;
+  void *rvalue;
+  void **avalue;
+  void *raw[2];
+};
+
+void ffi_forward_dispatch (ffi_cif *cif, void *rvalue, void **avalue,
+			   void *user_data) FFI_HIDDEN;
+#ifdef FFI_TARGET_HAS_FORWARD_FRAME
+void ffi_frame_forward_machdep (ffi_frame *frame, void (*fn)(void))
+  FFI_HIDDEN;
+#endif
+
+/* A register-frame closure has ffi_regs_closure_marker as its
+   function.  The target's closure entry recognises it and calls the
+   ffi_regs_target with the saved registers itself, so it is never
+   called.  */
+#ifdef FFI_TARGET_HAS_REGS_CLOSURE
+void ffi_regs_closure_marker (ffi_cif *cif, void *rvalue, void **avalue,
+			      void *user_data) FFI_HIDDEN;
+#endif
+
+/* Entry I of a thunk table is the code at CODE + I * STRIDE.  Calling
+   it ends up in ffi_thunk_dispatch with SLOTS + I * SLOT_SIZE as the
+   user data; each slot starts with a pointer back to the table.  MEM
+   is the executable block holding the entries, from
+   ffi_closure_alloc.  */
+struct ffi_thunk_table
+{
+  ffi_cif *cif;
+  void (*fun)(ffi_cif*,void*,void**,void*);
+  size_t count;
+  void **user_data;
+  void *mem;
+  char *code;
+  size_t stride;
+  char *slots;
+  size_t slot_size;
+  /* Closures allocated one by one: COUNT writable addresses, then COUNT
+     executable ones.  NULL when the entries are at a fixed stride.  */
+  void **entries;
+};
+
+void ffi_thunk_dispatch (ffi_cif *cif, void *rvalue, void **avalue,
+			 void *slot) FFI_HIDDEN;
+#ifdef FFI_TARGET_HAS_THUNK_TABLE
+/* Lay out compact entries for TABLE, whose cif, fun and count are
+   set, or return FFI_BAD_ABI to fall back to one closure per entry.  */
+ffi_status ffi_prep_thunk_table_machdep (ffi_thunk_table *table)
+  FFI_HIDDEN;
+#endif
+#endif
+
 #ifdef __cplusplus
 }
 #endif
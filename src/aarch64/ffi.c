@@ -61,26 +61,34 @@ struct call_context
 #include <mach/vm_param.h>
 #endif
 
-#else
-
-#if defined (__clang__) && defined (__APPLE__)
-extern void sys_icache_invalidate (void *start, size_t len);
 #endif
 
-static inline void
-ffi_clear_cache (void *start, void *end)
+/* Short vectors are homogeneous aggregate base types of their own, one
+   per register width regardless of the element type.  They live in the
+   same registers as double and long double respectively.  */
+#define AARCH64_HVA_D	(FFI_TYPE_LAST + 1)
+#define AARCH64_HVA_Q	(FFI_TYPE_LAST + 2)
+
+/* An array member counts as its element type: the element count only
+   matters through the size of the aggregate, which is checked
+   separately.  An array of structures is reported as a structure, so
+   that is_hfa0 and is_hfa1 look inside it through its elements list.  */
+
+static int
+hfa_base_type (const ffi_type *ty)
 {
-#if defined (__clang__) && defined (__APPLE__)
-  sys_icache_invalidate (start, (char *)end - (char *)start);
-#elif defined (__GNUC__)
-  __builtin___clear_cache (start, end);
-#else
-#error "Missing builtin to flush instruction cache"
-#endif
+  while (ty->type == FFI_TYPE_ARRAY)
+    {
+      if (ty->elements[0]->type == FFI_TYPE_STRUCT
+	  || ty->elements[0]->type == FFI_TYPE_COMPLEX)
+	return FFI_TYPE_STRUCT;
+      ty = ty->elements[0];
+    }
+  if (ty->type == FFI_TYPE_VECTOR)
+    return ty->size == 8 ? AARCH64_HVA_D : AARCH64_HVA_Q;
+  return ty->type;
 }
 
-#endif
-
 /* A subroutine of is_vfp_type.  Given a structure type, return the type code
    of the first non-structure element.  Recurse for structure elements.
    Return -1 if the structure is in fact empty, i.e. no nested elements.  */
@@ -94,7 +102,7 @@ is_hfa0 (const ffi_type *ty)
   if (elements != NULL)
     for (i = 0; elements[i]; ++i)
       {
-        ret = elements[i]->type;
+        ret = hfa_base_type (elements[i]);
         if (ret == FFI_TYPE_STRUCT || ret == FFI_TYPE_COMPLEX)
           {
             ret = is_hfa0 (elements[i]);
@@ -119,7 +127,7 @@ is_hfa1 (const ffi_type *ty, int candidate)
   if (elements != NULL)
     for (i = 0; elements[i]; ++i)
       {
-        int t = elements[i]->type;
+        int t = hfa_base_type (elements[i]);
         if (t == FFI_TYPE_STRUCT || t == FFI_TYPE_COMPLEX)
           {
             if (!is_hfa1 (elements[i], candidate))
@@ -156,6 +164,8 @@ is_vfp_type (const ffi_type *ty)
     case FFI_TYPE_FLOAT:
     case FFI_TYPE_DOUBLE:
     case FFI_TYPE_LONGDOUBLE:
+    case FFI_TYPE_FLOAT16:
+    case FFI_TYPE_BFLOAT16:
       ele_count = 1;
       goto done;
     case FFI_TYPE_COMPLEX:
@@ -169,18 +179,22 @@ is_vfp_type (const ffi_type *ty)
 	  goto done;
 	}
       return 0;
+    case FFI_TYPE_VECTOR:
+      candidate = hfa_base_type (ty);
+      ele_count = 1;
+      goto done;
     case FFI_TYPE_STRUCT:
       break;
     }
 
-  /* No HFA types are smaller than 4 bytes, or larger than 64 bytes.  */
+  /* No HFA types are smaller than 2 bytes, or larger than 64 bytes.  */
   size = ty->size;
-  if (size < 4 || size > 64)
+  if (size < 2 || size > 64)
     return 0;
 
   /* Find the type of the first non-structure member.  */
   elements = ty->elements;
-  candidate = elements[0]->type;
+  candidate = hfa_base_type (elements[0]);
   if (candidate == FFI_TYPE_STRUCT || candidate == FFI_TYPE_COMPLEX)
     {
       for (i = 0; ; ++i)
@@ -210,6 +224,18 @@ is_vfp_type (const ffi_type *ty)
       if (size != ele_count * sizeof(long double))
         return 0;
       break;
+    case FFI_TYPE_FLOAT16:
+    case FFI_TYPE_BFLOAT16:
+      ele_count = size / 2;
+      if (size != ele_count * 2)
+        return 0;
+      break;
+    case AARCH64_HVA_D:
+    case AARCH64_HVA_Q:
+      ele_count = size / (candidate == AARCH64_HVA_D ? 8 : 16);
+      if (size != ele_count * (candidate == AARCH64_HVA_D ? 8 : 16))
+        return 0;
+      break;
     default:
       return 0;
     }
@@ -219,7 +245,7 @@ is_vfp_type (const ffi_type *ty)
   /* Finally, make sure that all scalar elements are the same type.  */
   for (i = 0; elements[i]; ++i)
     {
-      int t = elements[i]->type;
+      int t = hfa_base_type (elements[i]);
       if (t == FFI_TYPE_STRUCT || t == FFI_TYPE_COMPLEX)
         {
           if (!is_hfa1 (elements[i], candidate))
@@ -231,9 +257,33 @@ is_vfp_type (const ffi_type *ty)
 
   /* All tests succeeded.  Encode the result.  */
  done:
+  if (candidate == AARCH64_HVA_D)
+    candidate = FFI_TYPE_DOUBLE;
+  else if (candidate == AARCH64_HVA_Q)
+    candidate = FFI_TYPE_LONGDOUBLE;
+  else if (candidate == FFI_TYPE_FLOAT16 || candidate == FFI_TYPE_BFLOAT16)
+    return AARCH64_RET_H4 + (4 - (int)ele_count);
   return candidate * 4 + (4 - (int)ele_count);
 }
 
+/* Return is_vfp_type (TY) for an argument, taking it from the cache in
+   cif->flags for the first AARCH64_FLAG_HFA_COUNT structures.  HFA is
+   the remaining cache and NSTRUCT the number of structures seen.  */
+
+static inline int
+arg_vfp_type (const ffi_type *ty, unsigned *hfa, int *nstruct)
+{
+  int h;
+
+  if (ty->type != FFI_TYPE_STRUCT || *nstruct == AARCH64_FLAG_HFA_COUNT)
+    return is_vfp_type (ty);
+
+  h = *hfa & ((1u << AARCH64_FLAG_HFA_BITS) - 1);
+  *hfa >>= AARCH64_FLAG_HFA_BITS;
+  ++*nstruct;
+  return h;
+}
+
 /* Representation of the procedure call argument marshalling
    state.
 
@@ -321,10 +371,23 @@ extend_hfa_type (void *dest, void *src, int h)
   ssize_t f = h - AARCH64_RET_S4;
   void *x0;
 
+  /* The H entries come before label 0, at negative offsets.  */
   asm volatile (
 	"adr	%0, 0f\n"
 "	add	%0, %0, %1\n"
 "	br	%0\n"
+"	ld4	{ v16.h, v17.h, v18.h, v19.h }[0], [%3]\n"	/* H4 */
+"	b	4f\n"
+"	nop\n"
+"	ld3	{ v16.h, v17.h, v18.h }[0], [%3]\n"	/* H3 */
+"	b	3f\n"
+"	nop\n"
+"	ld2	{ v16.h, v17.h }[0], [%3]\n"	/* H2 */
+"	b	2f\n"
+"	nop\n"
+"	ldr	h16, [%3]\n"		/* H1 */
+"	b	1f\n"
+"	nop\n"
 "0:	ldp	s16, s17, [%3]\n"	/* S4 */
 "	ldp	s18, s19, [%3, #8]\n"
 "	b	4f\n"
@@ -374,6 +437,34 @@ compress_hfa_type (void *dest, void *reg, int h)
 {
   switch (h)
     {
+    case AARCH64_RET_H1:
+      if (dest == reg)
+	{
+#ifdef __AARCH64EB__
+	  dest += 14;
+#endif
+	}
+      else
+	*(UINT16 *)dest = *(UINT16 *)reg;
+      break;
+    case AARCH64_RET_H2:
+      asm ("ldp q16, q17, [%1]\n\t"
+	   "st2 { v16.h, v17.h }[0], [%0]"
+	   : : "r"(dest), "r"(reg) : "memory", "v16", "v17");
+      break;
+    case AARCH64_RET_H3:
+      asm ("ldp q16, q17, [%1]\n\t"
+	   "ldr q18, [%1, #32]\n\t"
+	   "st3 { v16.h, v17.h, v18.h }[0], [%0]"
+	   : : "r"(dest), "r"(reg) : "memory", "v16", "v17", "v18");
+      break;
+    case AARCH64_RET_H4:
+      asm ("ldp q16, q17, [%1]\n\t"
+	   "ldp q18, q19, [%1, #32]\n\t"
+	   "st4 { v16.h, v17.h, v18.h, v19.h }[0], [%0]"
+	   : : "r"(dest), "r"(reg) : "memory", "v16", "v17", "v18", "v19");
+      break;
+
     case AARCH64_RET_S1:
       if (dest == reg)
 	{
@@ -454,12 +545,63 @@ allocate_int_to_reg_or_stack (struct call_context *context,
   return allocate_to_stack (state, stack, size, size);
 }
 
+/* As above, for a quad-word integer: these live in an even-numbered
+   pair of X registers, or in a 16-byte aligned stack slot.  */
+
+static void *
+allocate_int128_to_reg_or_stack (struct call_context *context,
+				 struct arg_state *state, void *stack)
+{
+  void *dest;
+
+  state->ngrn = (state->ngrn + 1) & ~1u;
+  if (state->ngrn + 2 <= N_X_ARG_REG)
+    {
+      dest = &context->x[state->ngrn];
+      state->ngrn += 2;
+      return dest;
+    }
+
+  state->ngrn = N_X_ARG_REG;
+  return allocate_to_stack (state, stack, 16, 16);
+}
+
+/* Note which of the arguments of CIF from FIRST on use the vector
+   registers, and the HFA classification of the structures among them.
+   *PNSTRUCT counts the structures seen so far.  */
+
+static ffi_status
+prep_args (ffi_cif *cif, unsigned first, int *pflags, int *pnstruct)
+{
+  int flags = *pflags, nstruct = *pnstruct, h;
+  unsigned i, n;
+
+  for (i = first, n = cif->nargs; i < n; i++)
+    {
+      ffi_type *ty = cif->arg_types[i];
+
+      /* Only 64- and 128-bit short vectors have a register.  */
+      if (ty->type == FFI_TYPE_VECTOR && ty->size != 8 && ty->size != 16)
+	return FFI_BAD_TYPEDEF;
+      h = is_vfp_type (ty);
+      if (h)
+	flags |= AARCH64_FLAG_ARG_V;
+      if (ty->type == FFI_TYPE_STRUCT && nstruct < AARCH64_FLAG_HFA_COUNT)
+	flags |= h << (AARCH64_FLAG_HFA_SHIFT
+		       + AARCH64_FLAG_HFA_BITS * nstruct++);
+    }
+
+  *pflags = flags;
+  *pnstruct = nstruct;
+  return FFI_OK;
+}
+
 ffi_status
 ffi_prep_cif_machdep (ffi_cif *cif)
 {
   ffi_type *rtype = cif->rtype;
   size_t bytes = cif->bytes;
-  int flags, i, n;
+  int flags, nstruct;
 
   switch (rtype->type)
     {
@@ -492,10 +634,20 @@ ffi_prep_cif_machdep (ffi_cif *cif)
     case FFI_TYPE_POINTER:
       flags = (sizeof(void *) == 4 ? AARCH64_RET_UINT32 : AARCH64_RET_INT64);
       break;
+    case FFI_TYPE_UINT128:
+    case FFI_TYPE_SINT128:
+      flags = AARCH64_RET_INT128;
+      break;
 
+    case FFI_TYPE_VECTOR:
+      if (rtype->size != 8 && rtype->size != 16)
+	return FFI_BAD_TYPEDEF;
+      /* FALLTHRU */
     case FFI_TYPE_FLOAT:
     case FFI_TYPE_DOUBLE:
     case FFI_TYPE_LONGDOUBLE:
+    case FFI_TYPE_FLOAT16:
+    case FFI_TYPE_BFLOAT16:
     case FFI_TYPE_STRUCT:
     case FFI_TYPE_COMPLEX:
       flags = is_vfp_type (rtype);
@@ -520,12 +672,9 @@ ffi_prep_cif_machdep (ffi_cif *cif)
       abort();
     }
 
-  for (i = 0, n = cif->nargs; i < n; i++)
-    if (is_vfp_type (cif->arg_types[i]))
-      {
-	flags |= AARCH64_FLAG_ARG_V;
-	break;
-      }
+  nstruct = 0;
+  if (prep_args (cif, 0, &flags, &nstruct) != FFI_OK)
+    return FFI_BAD_TYPEDEF;
 
   /* Round the stack up to a multiple of the stack alignment requirement. */
   cif->bytes = (unsigned) FFI_ALIGN(bytes, 16);
@@ -537,6 +686,38 @@ ffi_prep_cif_machdep (ffi_cif *cif)
   return FFI_OK;
 }
 
+/* For a variadic template, remember how many structures the fixed
+   arguments hold, so that the tail only classifies its own.  */
+
+ffi_status FFI_HIDDEN
+ffi_prep_var_template_machdep (ffi_var_template *tmpl)
+{
+  ffi_cif *cif = &tmpl->cif;
+  unsigned i, nstruct = 0;
+
+  for (i = 0; i < cif->nargs; i++)
+    if (cif->arg_types[i]->type == FFI_TYPE_STRUCT)
+      nstruct++;
+  tmpl->machdep[0] = nstruct;
+  return FFI_OK;
+}
+
+ffi_status FFI_HIDDEN
+ffi_prep_cif_machdep_var_tail (ffi_cif *cif, const ffi_var_template *tmpl)
+{
+  size_t bytes = cif->bytes;
+  int flags = cif->flags, nstruct = (int) tmpl->machdep[0];
+
+  if (prep_args (cif, tmpl->nfixedargs, &flags, &nstruct) != FFI_OK)
+    return FFI_BAD_TYPEDEF;
+  if (flags & AARCH64_RET_IN_MEM)
+    bytes += 8;
+
+  cif->bytes = (unsigned) FFI_ALIGN(bytes, 16);
+  cif->flags = flags;
+  return FFI_OK;
+}
+
 #if defined (__APPLE__)
 /* Perform Apple-specific cif processing for variadic calls */
 ffi_status ffi_prep_cif_machdep_var(ffi_cif *cif,
@@ -563,10 +744,14 @@ ffi_call_int (ffi_cif *cif, void (*fn)(void), void *orig_rvalue,
   void *stack, *frame, *rvalue;
   struct arg_state state;
   size_t stack_bytes, rtype_size, rsize;
-  int i, nargs, flags;
+  int i, nargs, flags, nstruct;
+  unsigned hfa;
   ffi_type *rtype;
+  FFI_STATS_START (ticks);
 
   flags = cif->flags;
+  hfa = (unsigned) flags >> AARCH64_FLAG_HFA_SHIFT;
+  nstruct = 0;
   rtype = cif->rtype;
   rtype_size = rtype->size;
   stack_bytes = cif->bytes;
@@ -639,15 +824,24 @@ ffi_call_int (ffi_cif *cif, void (*fn)(void), void *orig_rvalue,
 	  }
 	  break;
 
+	case FFI_TYPE_UINT128:
+	case FFI_TYPE_SINT128:
+	  memcpy (allocate_int128_to_reg_or_stack (context, &state, stack),
+		  a, 16);
+	  break;
+
 	case FFI_TYPE_FLOAT:
 	case FFI_TYPE_DOUBLE:
 	case FFI_TYPE_LONGDOUBLE:
+	case FFI_TYPE_FLOAT16:
+	case FFI_TYPE_BFLOAT16:
 	case FFI_TYPE_STRUCT:
 	case FFI_TYPE_COMPLEX:
+	case FFI_TYPE_VECTOR:
 	  {
 	    void *dest;
 
-	    h = is_vfp_type (ty);
+	    h = arg_vfp_type (ty, &hfa, &nstruct);
 	    if (h)
 	      {
 		int elems = 4 - (h & 3);
@@ -712,6 +906,7 @@ ffi_call_int (ffi_cif *cif, void (*fn)(void), void *orig_rvalue,
     }
 
   ffi_call_SYSV (context, frame, fn, rvalue, flags, closure);
+  FFI_STATS_STOP (ticks, cif, 0);
 
   if (flags & AARCH64_RET_NEED_COPY)
     memcpy (orig_rvalue, rvalue, rtype_size);
@@ -772,7 +967,7 @@ ffi_prep_closure_loc (ffi_closure *closure,
   
   *(UINT64 *)(tramp + 16) = (uintptr_t)start;
 
-  ffi_clear_cache(tramp, tramp + FFI_TRAMPOLINE_SIZE);
+  ffi_closure_flush_range (tramp, tramp + FFI_TRAMPOLINE_SIZE);
 #endif
 
   closure->cif = cif;
@@ -808,6 +1003,16 @@ ffi_prep_go_closure (ffi_go_closure *closure, ffi_cif* cif,
 }
 #endif /* FFI_GO_CLOSURES */
 
+ffi_status
+ffi_prep_regs_closure_loc (ffi_closure *closure, ffi_cif *cif,
+			   const ffi_regs_target *target, void *codeloc)
+{
+  if (target == NULL || target->fun == NULL)
+    return FFI_BAD_TYPEDEF;
+  return ffi_prep_closure_loc (closure, cif, ffi_regs_closure_marker,
+			       (void *) target, codeloc);
+}
+
 /* Primary handler to setup and invoke a function within a closure.
 
    A closure when invoked enters via the assembler wrapper
@@ -831,10 +1036,27 @@ ffi_closure_SYSV_inner (ffi_cif *cif,
 			struct call_context *context,
 			void *stack, void *rvalue, void *struct_rvalue)
 {
-  void **avalue = (void**) alloca (cif->nargs * sizeof (void*));
-  int i, h, nargs, flags;
+  void **avalue;
+  int i, h, nargs, flags, nstruct = 0;
+  unsigned hfa = cif->flags >> AARCH64_FLAG_HFA_SHIFT;
   struct arg_state state;
+  FFI_STATS_START (ticks);
+
+  /* A register-frame closure reads the call context, which is laid out
+     as ffi_regs, and the stack arguments itself.  */
+  if (fun == ffi_regs_closure_marker)
+    {
+      const ffi_regs_target *target = user_data;
+
+      if (cif->flags & AARCH64_RET_IN_MEM)
+	rvalue = struct_rvalue;
+      target->fun (cif, rvalue, (ffi_regs *) context, stack,
+		   target->user_data);
+      FFI_STATS_STOP (ticks, cif, 1);
+      return cif->flags;
+    }
 
+  avalue = (void**) alloca (cif->nargs * sizeof (void*));
   arg_init (&state);
 
   for (i = 0, nargs = cif->nargs; i < nargs; i++)
@@ -862,12 +1084,20 @@ ffi_closure_SYSV_inner (ffi_cif *cif,
 	  avalue[i] = allocate_int_to_reg_or_stack (context, &state, stack, s);
 	  break;
 
+	case FFI_TYPE_UINT128:
+	case FFI_TYPE_SINT128:
+	  avalue[i] = allocate_int128_to_reg_or_stack (context, &state, stack);
+	  break;
+
 	case FFI_TYPE_FLOAT:
 	case FFI_TYPE_DOUBLE:
 	case FFI_TYPE_LONGDOUBLE:
+	case FFI_TYPE_FLOAT16:
+	case FFI_TYPE_BFLOAT16:
 	case FFI_TYPE_STRUCT:
 	case FFI_TYPE_COMPLEX:
-	  h = is_vfp_type (ty);
+	case FFI_TYPE_VECTOR:
+	  h = arg_vfp_type (ty, &hfa, &nstruct);
 	  if (h)
 	    {
 	      n = 4 - (h & 3);
@@ -936,6 +1166,7 @@ ffi_closure_SYSV_inner (ffi_cif *cif,
     rvalue = struct_rvalue;
 
   fun (cif, rvalue, avalue, user_data);
+  FFI_STATS_STOP (ticks, cif, 1);
 
   return flags;
 }
@@ -77,5 +77,23 @@ typedef enum ffi_abi
 #endif
 
 #define FFI_TARGET_HAS_COMPLEX_TYPE
+#define FFI_TARGET_HAS_VECTOR_TYPE
+#define FFI_TARGET_HAS_VARIADIC_TAIL
+#define FFI_TARGET_HAS_INT128_TYPE
+#define FFI_TARGET_HAS_FLOAT16_TYPE
+#define FFI_TARGET_HAS_ARRAY_TYPE
+
+/* The argument registers saved on entry to a closure, as a
+   register-frame closure sees them: q0-q7, then x0-x7.  The vector
+   registers are only saved when the cif passes arguments in them.  */
+#define FFI_TARGET_HAS_REGS_CLOSURE
+#define FFI_REGS_NGPR 8
+#define FFI_REGS_NVEC 8
+#ifndef LIBFFI_ASM
+typedef struct {
+  unsigned char vec[FFI_REGS_NVEC][16];
+  unsigned long long gpr[FFI_REGS_NGPR];
+} ffi_regs;
+#endif
 
 #endif
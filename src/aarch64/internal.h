@@ -23,10 +23,13 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.  */
 #define AARCH64_RET_INT128	2
 
 #define AARCH64_RET_UNUSED3	3
-#define AARCH64_RET_UNUSED4	4
-#define AARCH64_RET_UNUSED5	5
-#define AARCH64_RET_UNUSED6	6
-#define AARCH64_RET_UNUSED7	7
+
+/* Half-precision and bfloat16 aggregates fill the free slots below the
+   single precision ones, as if their type code were 1.  */
+#define AARCH64_RET_H4		4
+#define AARCH64_RET_H3		5
+#define AARCH64_RET_H2		6
+#define AARCH64_RET_H1		7
 
 /* Note that FFI_TYPE_FLOAT == 2, _DOUBLE == 3, _LONGDOUBLE == 4,
    so _S4 through _Q1 are layed out as (TYPE * 4) + (4 - COUNT).  */
@@ -62,6 +65,14 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.  */
 #define AARCH64_FLAG_ARG_V_BIT	7
 #define AARCH64_FLAG_ARG_V	(1 << AARCH64_FLAG_ARG_V_BIT)
 
+/* The is_vfp_type classification of the first few structure arguments
+   is kept in the upper bits of cif->flags, so that the call and closure
+   paths need not walk their elements again.  The assembly only looks
+   at the bits above.  */
+#define AARCH64_FLAG_HFA_SHIFT	8
+#define AARCH64_FLAG_HFA_BITS	5
+#define AARCH64_FLAG_HFA_COUNT	4
+
 #define N_X_ARG_REG		8
 #define N_V_ARG_REG		8
 #define CALL_CONTEXT_SIZE	(N_V_ARG_REG * 16 + N_X_ARG_REG * 8)
@@ -576,8 +576,8 @@ ffi_prep_closure_loc (ffi_closure * closure,
   msync(closure->tramp, 8, 0x1000000);	/* clear data map */
   msync(codeloc, 8, 0x1000000);	/* clear insn map */
 #else
-  __clear_cache(closure->tramp, closure->tramp + 8);	/* clear data map */
-  __clear_cache(codeloc, codeloc + 8);			/* clear insn map */
+  ffi_closure_flush_range (closure->tramp, closure->tramp + 8); /* data map */
+  ffi_closure_flush_range (codeloc, (char *) codeloc + 8);	  /* insn map */
 #endif
   *(void (**)(void))(closure->tramp + 8) = closure_func;
 #endif
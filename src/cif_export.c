@@ -0,0 +1,481 @@
+/* -----------------------------------------------------------------------
+   cif_export.c - Save prepared cifs and load them back.
+
+   Permission is hereby granted, free of charge, to any person obtaining
+   a copy of this software and associated documentation files (the
+   ``Software''), to deal in the Software without restriction, including
+   without limitation the rights to use, copy, modify, merge, publish,
+   distribute, sublicense, and/or sell copies of the Software, and to
+   permit persons to whom the Software is furnished to do so, subject to
+   the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED ``AS IS'', WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+   NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+   ----------------------------------------------------------------------- */
+
+#include <fficonfig.h>
+#include <ffi.h>
+#include <ffi_common.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef FFI_HOST_NAME
+#define FFI_HOST_NAME "unknown"
+#endif
+
+/* An exported blob is a header, a table of every type reachable from
+   the cifs, one record per cif, and a table of type indices used for
+   structure elements and argument lists.  Types are written after
+   their elements, so an index always refers to an earlier entry.  The
+   primitive types of libffi are written as references to the ones in
+   the loading library rather than as copies.
+
+   Everything is stored in the byte order and sizes of the library that
+   wrote it.  The header records the library version, the host and the
+   sizes that matter, and a blob from any other build is refused.  The
+   cif records keep the machine-dependent bytes and flags, together with
+   any target-specific fields that follow them in ffi_cif, so loading a
+   cif does not run ffi_prep_cif again.  */
+
+#define BLOB_MAGIC "libffi-cif"
+#define BLOB_FORMAT 1
+#define BLOB_KEY_SIZE 64
+
+struct blob_header
+{
+  char magic[12];
+  uint32_t format;
+  uint32_t endian;
+  uint32_t sizeof_cif;
+  uint32_t sizeof_ptr;
+  uint32_t type_last;
+  uint32_t abi_last;
+  char key[BLOB_KEY_SIZE];
+  uint32_t ntypes;
+  uint32_t ncifs;
+  uint32_t nrefs;
+  uint32_t checksum;
+  uint64_t total;
+};
+
+struct blob_type
+{
+  uint64_t size;
+  uint32_t builtin;		/* Index into builtin_types plus one.  */
+  uint32_t type;
+  uint32_t alignment;
+  uint32_t nelements;
+  uint32_t first;		/* Index of the first element in the refs.  */
+  uint32_t pad;
+};
+
+struct blob_cif
+{
+  uint32_t abi;
+  uint32_t nargs;
+  uint32_t rtype;
+  uint32_t first;
+  uint32_t bytes;
+  uint32_t flags;
+};
+
+/* The part of ffi_cif after FLAGS, if the target defines any.  */
+#define CIF_EXTRA_OFFSET (offsetof (ffi_cif, flags) + sizeof (unsigned))
+#define CIF_EXTRA_SIZE (sizeof (ffi_cif) - CIF_EXTRA_OFFSET)
+#define CIF_RECORD_SIZE \
+  FFI_ALIGN (sizeof (struct blob_cif) + CIF_EXTRA_SIZE, 8)
+
+static ffi_type *const builtin_types[] = {
+  &ffi_type_void,
+  &ffi_type_uint8, &ffi_type_sint8,
+  &ffi_type_uint16, &ffi_type_sint16,
+  &ffi_type_uint32, &ffi_type_sint32,
+  &ffi_type_uint64, &ffi_type_sint64,
+  &ffi_type_float, &ffi_type_double, &ffi_type_longdouble,
+  &ffi_type_pointer,
+#ifdef FFI_TARGET_HAS_COMPLEX_TYPE
+  &ffi_type_complex_float, &ffi_type_complex_double,
+  &ffi_type_complex_longdouble,
+#endif
+#ifdef FFI_TARGET_HAS_INT128_TYPE
+  &ffi_type_uint128, &ffi_type_sint128,
+#endif
+#ifdef FFI_TARGET_HAS_FLOAT16_TYPE
+  &ffi_type_float16, &ffi_type_bfloat16,
+#endif
+};
+
+#define NBUILTIN (sizeof (builtin_types) / sizeof (builtin_types[0]))
+
+static void
+blob_key (char key[BLOB_KEY_SIZE])
+{
+  memset (key, 0, BLOB_KEY_SIZE);
+  strncpy (key, PACKAGE_VERSION " " FFI_HOST_NAME, BLOB_KEY_SIZE - 1);
+}
+
+static uint32_t
+blob_checksum (const unsigned char *p, size_t size)
+{
+  uint32_t h = 2166136261u;
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    h = (h ^ p[i]) * 16777619u;
+  return h;
+}
+
+static unsigned
+builtin_index (const ffi_type *t)
+{
+  unsigned i;
+
+  for (i = 0; i < NBUILTIN; i++)
+    if (builtin_types[i] == t)
+      return i + 1;
+  return 0;
+}
+
+/* ---- Export ----------------------------------------------------------- */
+
+struct export_state
+{
+  ffi_type **types;
+  size_t ntypes;
+  size_t cap;
+  size_t nrefs;
+};
+
+static long
+export_find (const struct export_state *st, const ffi_type *t)
+{
+  size_t i;
+
+  for (i = 0; i < st->ntypes; i++)
+    if (st->types[i] == t)
+      return (long) i;
+  return -1;
+}
+
+/* Enter T and everything it refers to into the type table.  */
+
+static int
+export_visit (struct export_state *st, ffi_type *t)
+{
+  ffi_type **e;
+
+  if (t == NULL || export_find (st, t) >= 0)
+    return t != NULL;
+
+  if (!builtin_index (t) && t->elements != NULL)
+    for (e = t->elements; *e; e++)
+      {
+	if (!export_visit (st, *e))
+	  return 0;
+	st->nrefs++;
+      }
+
+  if (st->ntypes == st->cap)
+    {
+      size_t cap = st->cap ? st->cap * 2 : 32;
+      ffi_type **n = realloc (st->types, cap * sizeof (ffi_type *));
+
+      if (n == NULL)
+	return 0;
+      st->types = n;
+      st->cap = cap;
+    }
+  st->types[st->ntypes++] = t;
+  return 1;
+}
+
+size_t
+ffi_cif_export (ffi_cif *const *cifs, size_t ncifs, void *buf, size_t size)
+{
+  struct export_state st;
+  struct blob_header *hdr;
+  struct blob_type *bt;
+  unsigned char *rec;
+  uint32_t *refs;
+  size_t i, j, total, nref;
+
+  if (cifs == NULL && ncifs != 0)
+    return 0;
+
+  memset (&st, 0, sizeof (st));
+  for (i = 0; i < ncifs; i++)
+    {
+      ffi_cif *cif = cifs[i];
+
+      if (cif == NULL || cif->rtype == NULL
+	  || (cif->nargs != 0 && cif->arg_types == NULL)
+	  || !export_visit (&st, cif->rtype))
+	goto fail;
+      for (j = 0; j < cif->nargs; j++)
+	if (!export_visit (&st, cif->arg_types[j]))
+	  goto fail;
+      st.nrefs += cif->nargs;
+    }
+
+  total = sizeof (struct blob_header)
+	  + st.ntypes * sizeof (struct blob_type)
+	  + ncifs * CIF_RECORD_SIZE
+	  + st.nrefs * sizeof (uint32_t);
+  if (buf == NULL || size < total)
+    {
+      free (st.types);
+      return total;
+    }
+
+  memset (buf, 0, total);
+  hdr = buf;
+  bt = (struct blob_type *) (hdr + 1);
+  rec = (unsigned char *) (bt + st.ntypes);
+  refs = (uint32_t *) (rec + ncifs * CIF_RECORD_SIZE);
+
+  memcpy (hdr->magic, BLOB_MAGIC, sizeof (BLOB_MAGIC));
+  hdr->format = BLOB_FORMAT;
+  hdr->endian = 0x01020304;
+  hdr->sizeof_cif = sizeof (ffi_cif);
+  hdr->sizeof_ptr = sizeof (void *);
+  hdr->type_last = FFI_TYPE_LAST;
+  hdr->abi_last = FFI_LAST_ABI;
+  blob_key (hdr->key);
+  hdr->ntypes = (uint32_t) st.ntypes;
+  hdr->ncifs = (uint32_t) ncifs;
+  hdr->nrefs = (uint32_t) st.nrefs;
+  hdr->total = total;
+
+  nref = 0;
+  for (i = 0; i < st.ntypes; i++)
+    {
+      ffi_type *t = st.types[i];
+      ffi_type **e;
+
+      bt[i].size = t->size;
+      bt[i].builtin = builtin_index (t);
+      bt[i].type = t->type;
+      bt[i].alignment = t->alignment;
+      bt[i].first = (uint32_t) nref;
+      if (!bt[i].builtin && t->elements != NULL)
+	for (e = t->elements; *e; e++)
+	  {
+	    refs[nref++] = (uint32_t) export_find (&st, *e);
+	    bt[i].nelements++;
+	  }
+    }
+
+  for (i = 0; i < ncifs; i++, rec += CIF_RECORD_SIZE)
+    {
+      const ffi_cif *cif = cifs[i];
+      struct blob_cif *bc = (struct blob_cif *) rec;
+
+      bc->abi = cif->abi;
+      bc->nargs = cif->nargs;
+      bc->rtype = (uint32_t) export_find (&st, cif->rtype);
+      bc->first = (uint32_t) nref;
+      bc->bytes = cif->bytes;
+      bc->flags = cif->flags;
+      memcpy (bc + 1, (const char *) cif + CIF_EXTRA_OFFSET, CIF_EXTRA_SIZE);
+      for (j = 0; j < cif->nargs; j++)
+	refs[nref++] = (uint32_t) export_find (&st, cif->arg_types[j]);
+    }
+
+  hdr->checksum = blob_checksum ((const unsigned char *) (hdr + 1),
+				 total - sizeof (*hdr));
+  free (st.types);
+  return total;
+
+ fail:
+  free (st.types);
+  return 0;
+}
+
+/* ---- Import ----------------------------------------------------------- */
+
+static ffi_status
+import_check_header (const struct blob_header *hdr, size_t size)
+{
+  char key[BLOB_KEY_SIZE];
+  uint64_t need;
+
+  if (memcmp (hdr->magic, BLOB_MAGIC, sizeof (BLOB_MAGIC)) != 0
+      || hdr->format != BLOB_FORMAT)
+    return FFI_BAD_TYPEDEF;
+
+  /* A well-formed blob from a different build.  */
+  blob_key (key);
+  if (hdr->endian != 0x01020304
+      || hdr->sizeof_cif != sizeof (ffi_cif)
+      || hdr->sizeof_ptr != sizeof (void *)
+      || hdr->type_last != FFI_TYPE_LAST
+      || hdr->abi_last != FFI_LAST_ABI
+      || memcmp (hdr->key, key, BLOB_KEY_SIZE) != 0)
+    return FFI_BAD_ABI;
+
+  need = sizeof (*hdr)
+	 + (uint64_t) hdr->ntypes * sizeof (struct blob_type)
+	 + (uint64_t) hdr->ncifs * CIF_RECORD_SIZE
+	 + (uint64_t) hdr->nrefs * sizeof (uint32_t);
+  if (hdr->total != need || need != size
+      || hdr->checksum != blob_checksum ((const unsigned char *) (hdr + 1),
+					 size - sizeof (*hdr)))
+    return FFI_BAD_TYPEDEF;
+  return FFI_OK;
+}
+
+/* Check that a run of COUNT indices starting at FIRST lies inside the
+   refs table, and that each index is below LIMIT.  */
+
+static int
+import_check_refs (const struct blob_header *hdr, const uint32_t *refs,
+		   uint32_t first, uint32_t count, uint32_t limit)
+{
+  uint32_t i;
+
+  if (first > hdr->nrefs || count > hdr->nrefs - first)
+    return 0;
+  for (i = 0; i < count; i++)
+    if (refs[first + i] >= limit)
+      return 0;
+  return 1;
+}
+
+ffi_status
+ffi_cif_import (const void *blob, size_t size, ffi_cif **cifs,
+		size_t *ncifs)
+{
+  const struct blob_header *hdr = blob;
+  const struct blob_type *bt;
+  const unsigned char *rec;
+  const uint32_t *refs;
+  ffi_status status;
+  ffi_cif *out;
+  ffi_type *types, **map, **slots;
+  size_t i, j, nslots, off_types, off_map, off_slots;
+
+  if (blob == NULL || cifs == NULL || ncifs == NULL
+      || size < sizeof (*hdr) || ((uintptr_t) blob & 7) != 0)
+    return FFI_BAD_TYPEDEF;
+  status = import_check_header (hdr, size);
+  if (status != FFI_OK)
+    return status;
+
+  bt = (const struct blob_type *) (hdr + 1);
+  rec = (const unsigned char *) (bt + hdr->ntypes);
+  refs = (const uint32_t *) (rec + (size_t) hdr->ncifs * CIF_RECORD_SIZE);
+
+  /* Validate everything before allocating.  */
+  nslots = 0;
+  for (i = 0; i < hdr->ntypes; i++)
+    {
+      if (bt[i].builtin)
+	{
+	  const ffi_type *t;
+
+	  if (bt[i].builtin > NBUILTIN)
+	    return FFI_BAD_TYPEDEF;
+	  t = builtin_types[bt[i].builtin - 1];
+	  if (bt[i].size != t->size || bt[i].alignment != t->alignment
+	      || bt[i].type != t->type || bt[i].nelements != 0)
+	    return FFI_BAD_TYPEDEF;
+	  continue;
+	}
+      if (bt[i].type > FFI_TYPE_LAST
+	  || bt[i].size == 0 || bt[i].size > (size_t) -1
+	  || bt[i].alignment == 0 || bt[i].alignment > 0xffff
+	  || (bt[i].alignment & (bt[i].alignment - 1)) != 0
+	  || !import_check_refs (hdr, refs, bt[i].first, bt[i].nelements,
+				 (uint32_t) i))
+	return FFI_BAD_TYPEDEF;
+      if (bt[i].type == FFI_TYPE_STRUCT && bt[i].nelements == 0)
+	return FFI_BAD_TYPEDEF;
+      if (bt[i].nelements)
+	nslots += bt[i].nelements + 1;
+    }
+  for (i = 0; i < hdr->ncifs; i++)
+    {
+      const struct blob_cif *bc
+	= (const struct blob_cif *) (rec + i * CIF_RECORD_SIZE);
+
+      if (!(bc->abi > FFI_FIRST_ABI && bc->abi < FFI_LAST_ABI)
+	  || bc->rtype >= hdr->ntypes
+	  || !import_check_refs (hdr, refs, bc->first, bc->nargs,
+				 hdr->ntypes))
+	return FFI_BAD_TYPEDEF;
+      nslots += bc->nargs;
+    }
+
+  off_types = FFI_ALIGN ((size_t) hdr->ncifs * sizeof (ffi_cif),
+			 FFI_SIZEOF_ARG);
+  off_map = off_types + (size_t) hdr->ntypes * sizeof (ffi_type);
+  off_slots = off_map + (size_t) hdr->ntypes * sizeof (ffi_type *);
+  out = malloc (off_slots + nslots * sizeof (ffi_type *) + 1);
+  if (out == NULL)
+    return FFI_BAD_TYPEDEF;
+  types = (ffi_type *) ((char *) out + off_types);
+  map = (ffi_type **) ((char *) out + off_map);
+  slots = (ffi_type **) ((char *) out + off_slots);
+
+  /* Element indices always point backwards, so one pass in order
+     fills in every type.  */
+  for (i = 0; i < hdr->ntypes; i++)
+    {
+      ffi_type *t;
+
+      if (bt[i].builtin)
+	{
+	  map[i] = builtin_types[bt[i].builtin - 1];
+	  continue;
+	}
+      t = map[i] = &types[i];
+      t->size = (size_t) bt[i].size;
+      t->alignment = (unsigned short) bt[i].alignment;
+      t->type = (unsigned short) bt[i].type;
+      t->elements = NULL;
+      if (bt[i].nelements)
+	{
+	  t->elements = slots;
+	  for (j = 0; j < bt[i].nelements; j++)
+	    *slots++ = map[refs[bt[i].first + j]];
+	  *slots++ = NULL;
+	}
+    }
+
+  for (i = 0; i < hdr->ncifs; i++, rec += CIF_RECORD_SIZE)
+    {
+      const struct blob_cif *bc = (const struct blob_cif *) rec;
+      ffi_cif *cif = &out[i];
+
+      memcpy ((char *) cif + CIF_EXTRA_OFFSET, bc + 1, CIF_EXTRA_SIZE);
+      cif->abi = (ffi_abi) bc->abi;
+      cif->nargs = bc->nargs;
+      cif->rtype = map[bc->rtype];
+      cif->arg_types = bc->nargs ? slots : NULL;
+      cif->bytes = bc->bytes;
+      cif->flags = bc->flags;
+      for (j = 0; j < bc->nargs; j++)
+	*slots++ = map[refs[bc->first + j]];
+    }
+
+  *cifs = out;
+  *ncifs = hdr->ncifs;
+  return FFI_OK;
+}
+
+void
+ffi_cif_import_free (ffi_cif *cifs)
+{
+  free (cifs);
+}
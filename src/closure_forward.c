@@ -0,0 +1,91 @@
+/* -----------------------------------------------------------------------
+   closure_forward.c - Closures that pass their arguments on unchanged.
+
+   Permission is hereby granted, free of charge, to any person obtaining
+   a copy of this software and associated documentation files (the
+   ``Software''), to deal in the Software without restriction, including
+   without limitation the rights to use, copy, modify, merge, publish,
+   distribute, sublicense, and/or sell copies of the Software, and to
+   permit persons to whom the Software is furnished to do so, subject to
+   the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED ``AS IS'', WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+   NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+   ----------------------------------------------------------------------- */
+
+
+#include <ffi.h>
+#include <ffi_common.h>
+#include <stdlib.h>
+
+#if FFI_CLOSURES
+
+/* A forwarding closure is an ordinary closure whose function is
+   ffi_forward_dispatch and whose user data points to an
+   ffi_forward_target.  Targets that know about it catch it before the
+   arguments are unpacked and hand the handler a frame describing the
+   incoming registers and stack; everywhere else, and for cifs a target
+   leaves to the generic code, the frame holds the unpacked argument
+   values and forwarding is an ordinary ffi_call.  */
+
+void FFI_HIDDEN
+ffi_forward_dispatch (ffi_cif *cif, void *rvalue, void **avalue,
+		      void *user_data)
+{
+  const ffi_forward_target *target = user_data;
+  ffi_frame frame;
+
+  frame.cif = cif;
+  frame.rvalue = rvalue;
+  frame.avalue = avalue;
+  frame.raw[0] = frame.raw[1] = NULL;
+  target->fun (cif, rvalue, &frame, target->user_data);
+}
+
+#ifdef FFI_TARGET_HAS_REGS_CLOSURE
+void FFI_HIDDEN
+ffi_regs_closure_marker (ffi_cif *cif, void *rvalue, void **avalue,
+			 void *user_data)
+{
+  (void) cif;
+  (void) rvalue;
+  (void) avalue;
+  (void) user_data;
+  abort ();
+}
+#endif
+
+ffi_status
+ffi_prep_forward_closure_loc (ffi_closure *closure, ffi_cif *cif,
+			      const ffi_forward_target *target,
+			      void *codeloc)
+{
+  if (target == NULL || target->fun == NULL)
+    return FFI_BAD_TYPEDEF;
+  return ffi_prep_closure_loc (closure, cif, ffi_forward_dispatch,
+			       (void *) target, codeloc);
+}
+
+void
+ffi_frame_forward (ffi_frame *frame, void (*fn)(void))
+{
+#ifdef FFI_TARGET_HAS_FORWARD_FRAME
+  if (frame->raw[0] != NULL)
+    {
+      ffi_frame_forward_machdep (frame, fn);
+      return;
+    }
+#endif
+  ffi_call (frame->cif, fn, frame->rvalue, frame->avalue);
+}
+
+#endif /* FFI_CLOSURES */
@@ -0,0 +1,157 @@
+/* -----------------------------------------------------------------------
+   closure_sync.c - Deferred instruction cache maintenance for closures.
+
+   Permission is hereby granted, free of charge, to any person obtaining
+   a copy of this software and associated documentation files (the
+   ``Software''), to deal in the Software without restriction, including
+   without limitation the rights to use, copy, modify, merge, publish,
+   distribute, sublicense, and/or sell copies of the Software, and to
+   permit persons to whom the Software is furnished to do so, subject to
+   the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED ``AS IS'', WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+   NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+   ----------------------------------------------------------------------- */
+
+#include <ffi.h>
+#include <ffi_common.h>
+#include <stdint.h>
+
+#if FFI_CLOSURES
+
+#if defined (__clang__) && defined (__APPLE__)
+extern void sys_icache_invalidate (void *start, size_t len);
+#endif
+
+#ifdef _MSC_VER
+# define SYNC_THREAD __declspec(thread)
+#else
+# define SYNC_THREAD __thread
+#endif
+
+/* Dirty ranges are rounded out to SYNC_GRANULE bytes, which is no
+   larger than the page size of any supported target, so that the
+   trampolines of closures allocated from the same page collapse into
+   a single range.  The pending list is per thread; when it fills up,
+   it is flushed early rather than grown.  */
+
+#define SYNC_GRANULE	4096
+#define SYNC_RANGES	16
+
+struct sync_range
+{
+  char *start;
+  char *end;
+};
+
+static SYNC_THREAD int sync_deferred;
+static SYNC_THREAD unsigned sync_count;
+static SYNC_THREAD struct sync_range sync_ranges[SYNC_RANGES];
+
+static void
+sync_clear_cache (char *start, char *end)
+{
+#if defined (__i386__) || defined (__x86_64__) \
+    || defined (_M_IX86) || defined (_M_X64)
+  /* x86 keeps the instruction cache coherent with stores.  */
+  (void) start;
+  (void) end;
+#elif defined (__clang__) && defined (__APPLE__)
+  sys_icache_invalidate (start, end - start);
+#elif defined (__GNUC__)
+  __builtin___clear_cache (start, end);
+#else
+#error "Missing builtin to flush instruction cache"
+#endif
+}
+
+void
+ffi_closure_flush_range (void *start, void *end)
+{
+  char *s, *e;
+  unsigned i;
+
+  if (!sync_deferred)
+    {
+      sync_clear_cache (start, end);
+      return;
+    }
+
+  s = (char *) ((uintptr_t) start & -(uintptr_t) SYNC_GRANULE);
+  e = (char *) (((uintptr_t) end + SYNC_GRANULE - 1)
+		& -(uintptr_t) SYNC_GRANULE);
+
+  for (i = 0; i < sync_count; i++)
+    {
+      struct sync_range *r = &sync_ranges[i];
+
+      if (s <= r->end && e >= r->start)
+	{
+	  if (s < r->start)
+	    r->start = s;
+	  if (e > r->end)
+	    r->end = e;
+	  return;
+	}
+    }
+
+  if (sync_count == SYNC_RANGES)
+    ffi_closure_sync ();
+  sync_ranges[sync_count].start = s;
+  sync_ranges[sync_count].end = e;
+  sync_count++;
+}
+
+void
+ffi_closure_sync (void)
+{
+  unsigned i, j;
+
+  /* Ranges that grew into each other after they were recorded are
+     merged here, so that each page is flushed only once.  */
+  for (i = 0; i < sync_count; i++)
+    {
+      struct sync_range *r = &sync_ranges[i];
+
+      for (j = i + 1; j < sync_count; )
+	{
+	  struct sync_range *q = &sync_ranges[j];
+
+	  if (q->start <= r->end && q->end >= r->start)
+	    {
+	      if (q->start < r->start)
+		r->start = q->start;
+	      if (q->end > r->end)
+		r->end = q->end;
+	      *q = sync_ranges[--sync_count];
+	      j = i + 1;
+	    }
+	  else
+	    j++;
+	}
+      sync_clear_cache (r->start, r->end);
+    }
+  sync_count = 0;
+}
+
+int
+ffi_closure_defer_sync (int defer)
+{
+  int old = sync_deferred;
+
+  sync_deferred = defer != 0;
+  if (!sync_deferred)
+    ffi_closure_sync ();
+  return old;
+}
+
+#endif /* FFI_CLOSURES */
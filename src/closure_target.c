@@ -0,0 +1,80 @@
+/* -----------------------------------------------------------------------
+   closure_target.c - Closures whose target can be replaced.
+
+   Permission is hereby granted, free of charge, to any person obtaining
+   a copy of this software and associated documentation files (the
+   ``Software''), to deal in the Software without restriction, including
+   without limitation the rights to use, copy, modify, merge, publish,
+   distribute, sublicense, and/or sell copies of the Software, and to
+   permit persons to whom the Software is furnished to do so, subject to
+   the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED ``AS IS'', WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+   NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+   ----------------------------------------------------------------------- */
+
+#include <ffi.h>
+#include <ffi_common.h>
+
+#if FFI_CLOSURES
+
+#ifdef _MSC_VER
+#include <windows.h>
+#endif
+
+/* A retargetable closure is an ordinary closure whose function is
+   closure_target_dispatch and whose user data points to an immutable
+   ffi_closure_target.  Retargeting replaces that one pointer, so the
+   trampoline is never rewritten and a call racing with the change
+   sees either the old function and data or the new ones.  The old
+   target is handed back, and the caller must keep it alive until no
+   call can still be using it.  */
+
+static void
+closure_target_dispatch (ffi_cif *cif, void *rvalue, void **avalue,
+			 void *user_data)
+{
+  const ffi_closure_target *target = user_data;
+
+  target->fun (cif, rvalue, avalue, target->user_data);
+}
+
+ffi_status
+ffi_prep_retargetable_closure_loc (ffi_closure *closure, ffi_cif *cif,
+				   const ffi_closure_target *target,
+				   void *codeloc)
+{
+  if (target == NULL || target->fun == NULL)
+    return FFI_BAD_TYPEDEF;
+  return ffi_prep_closure_loc (closure, cif, closure_target_dispatch,
+			       (void *) target, codeloc);
+}
+
+const ffi_closure_target *
+ffi_closure_retarget (ffi_closure *closure, const ffi_closure_target *target)
+{
+  if (closure == NULL || target == NULL || target->fun == NULL
+      || closure->fun != closure_target_dispatch)
+    return NULL;
+
+  /* The release makes the contents of TARGET visible before the
+     pointer to it; callers only read through the pointer.  */
+#ifdef _MSC_VER
+  return InterlockedExchangePointer ((PVOID volatile *) &closure->user_data,
+				     (PVOID) target);
+#else
+  return __atomic_exchange_n (&closure->user_data, (void *) target,
+			      __ATOMIC_ACQ_REL);
+#endif
+}
+
+#endif /* FFI_CLOSURES */
@@ -34,6 +34,22 @@
 #include <ffi.h>
 #include <ffi_common.h>
 
+#if FFI_CLOSURES
+/* How the closure allocator maps executable memory.  FFI_EXEC_PROBE
+   until set by ffi_closure_exec_mode or decided by the allocator.  */
+static ffi_exec_mode exec_mode = FFI_EXEC_PROBE;
+
+ffi_exec_mode
+ffi_closure_exec_mode (ffi_exec_mode mode)
+{
+  ffi_exec_mode old = exec_mode;
+
+  if (mode >= FFI_EXEC_PROBE && mode <= FFI_EXEC_EMUTRAMP)
+    exec_mode = mode;
+  return old;
+}
+#endif /* FFI_CLOSURES */
+
 #ifdef __NetBSD__
 #include <sys/param.h>
 #endif
@@ -391,6 +407,9 @@ ffi_closure_free (void *ptr)
 #endif /* HAVE_MNTENT */
 #include <sys/param.h>
 #include <pthread.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
 
 /* We don't want sys/mman.h to be included after we redefine mmap and
    dlmunmap.  */
@@ -401,57 +420,28 @@ ffi_closure_free (void *ptr)
 #include <sys/statfs.h>
 #include <stdlib.h>
 
-static int selinux_enabled = -1;
-
+/* Look for selinuxfs where it is mounted, rather than reading the
+   whole mount table.  */
 static int
 selinux_enabled_check (void)
 {
+  static const char *const mounts[] = { "/sys/fs/selinux", "/selinux" };
   struct statfs sfs;
-  FILE *f;
-  char *buf = NULL;
-  size_t len = 0;
+  size_t i;
 
-  if (statfs ("/selinux", &sfs) >= 0
-      && (unsigned int) sfs.f_type == 0xf97cff8cU)
-    return 1;
-  f = fopen ("/proc/mounts", "r");
-  if (f == NULL)
-    return 0;
-  while (getline (&buf, &len, f) >= 0)
-    {
-      char *p = strchr (buf, ' ');
-      if (p == NULL)
-        break;
-      p = strchr (p + 1, ' ');
-      if (p == NULL)
-        break;
-      if (strncmp (p + 1, "selinuxfs ", 10) == 0)
-        {
-          free (buf);
-          fclose (f);
-          return 1;
-        }
-    }
-  free (buf);
-  fclose (f);
+  for (i = 0; i < sizeof (mounts) / sizeof (*mounts); i++)
+    if (statfs (mounts[i], &sfs) >= 0
+	&& (unsigned int) sfs.f_type == 0xf97cff8cU)
+      return 1;
   return 0;
 }
 
-#define is_selinux_enabled() (selinux_enabled >= 0 ? selinux_enabled \
-			      : (selinux_enabled = selinux_enabled_check ()))
-
-#else
-
-#define is_selinux_enabled() 0
-
-#endif /* !FFI_MMAP_EXEC_SELINUX */
+#endif /* FFI_MMAP_EXEC_SELINUX */
 
 /* On PaX enable kernels that have MPROTECT enable we can't use PROT_EXEC. */
 #ifdef FFI_MMAP_EXEC_EMUTRAMP_PAX
 #include <stdlib.h>
 
-static int emutramp_enabled = -1;
-
 static int
 emutramp_enabled_check (void)
 {
@@ -476,24 +466,14 @@ emutramp_enabled_check (void)
   fclose (f);
   return ret;
 }
-
-#define is_emutramp_enabled() (emutramp_enabled >= 0 ? emutramp_enabled \
-                               : (emutramp_enabled = emutramp_enabled_check ()))
 #endif /* FFI_MMAP_EXEC_EMUTRAMP_PAX */
 
 #elif defined (__CYGWIN__) || defined(__INTERIX)
 
 #include <sys/mman.h>
 
-/* Cygwin is Linux-like, but not quite that Linux-like.  */
-#define is_selinux_enabled() 0
-
 #endif /* !defined(X86_WIN32) && !defined(X86_WIN64) */
 
-#ifndef FFI_MMAP_EXEC_EMUTRAMP_PAX
-#define is_emutramp_enabled() 0
-#endif /* FFI_MMAP_EXEC_EMUTRAMP_PAX */
-
 /* Declare all functions defined in dlmalloc.c as static.  */
 static void *dlmalloc(size_t);
 static void dlfree(void*);
@@ -537,6 +517,8 @@ static int execfd = -1;
 /* The amount of space already allocated from the temporary file.  */
 static size_t execsize = 0;
 
+static void exec_atfork_register (void);
+
 /* Open a temporary file name, and immediately unlink it.  */
 static int
 open_temp_exec_file_name (char *name, int flags)
@@ -594,6 +576,28 @@ open_temp_exec_file_dir (const char *dir)
   return open_temp_exec_file_name (tempname, flags);
 }
 
+#if defined(__linux__) && defined(SYS_memfd_create) && defined(MFD_CLOEXEC)
+#define HAVE_EXEC_MEMFD 1
+/* Create an anonymous file that lives only in memory.  This needs no
+   writable directory and no search of the mount table.  Asking for an
+   executable memfd keeps Linux 6.3 and later from warning about it;
+   older kernels reject the flag, and are asked again without it.
+   Where an executable memfd is refused, the mapping fails and the
+   next location is tried.  */
+static int
+open_temp_exec_file_memfd (const char *name)
+{
+  int fd;
+
+#ifdef MFD_EXEC
+  fd = syscall (SYS_memfd_create, name, MFD_CLOEXEC | MFD_EXEC);
+  if (fd != -1 || errno != EINVAL)
+    return fd;
+#endif
+  return syscall (SYS_memfd_create, name, MFD_CLOEXEC);
+}
+#endif
+
 /* Open a temporary file in the directory in the named environment
    variable.  */
 static int
@@ -664,6 +668,9 @@ static struct
   const char *arg;
   int repeat;
 } open_temp_exec_file_opts[] = {
+#ifdef HAVE_EXEC_MEMFD
+  { open_temp_exec_file_memfd, "libffi", 0 },
+#endif
   { open_temp_exec_file_env, "TMPDIR", 0 },
   { open_temp_exec_file_dir, "/tmp", 0 },
   { open_temp_exec_file_dir, "/var/tmp", 0 },
@@ -770,6 +777,7 @@ dlmmap_locked (void *start, size_t length, int prot, int flags, off_t offset)
       execfd = open_temp_exec_file ();
       if (execfd == -1)
 	return MFAIL;
+      exec_atfork_register ();
     }
 
   offset = execsize;
@@ -812,12 +820,50 @@ dlmmap_locked (void *start, size_t length, int prot, int flags, off_t offset)
   return start;
 }
 
+/* Decide how executable memory is to be mapped: LIBFFI_EXEC_MODE
+   first, then PaX trampoline emulation, then SELinux.  */
+static ffi_exec_mode
+exec_mode_probe (void)
+{
+  const char *env = getenv ("LIBFFI_EXEC_MODE");
+
+  if (env != NULL)
+    {
+      if (strcmp (env, "direct") == 0)
+	return FFI_EXEC_DIRECT;
+      if (strcmp (env, "split") == 0)
+	return FFI_EXEC_SPLIT;
+      if (strcmp (env, "emutramp") == 0)
+	return FFI_EXEC_EMUTRAMP;
+    }
+#ifdef FFI_MMAP_EXEC_EMUTRAMP_PAX
+  if (emutramp_enabled_check ())
+    return FFI_EXEC_EMUTRAMP;
+#endif
+#if FFI_MMAP_EXEC_SELINUX
+  if (selinux_enabled_check ())
+    return FFI_EXEC_SPLIT;
+#endif
+  return FFI_EXEC_DIRECT;
+}
+
+/* The probe runs once per process; racing threads reach the same
+   answer.  */
+static ffi_exec_mode
+exec_mode_get (void)
+{
+  if (exec_mode == FFI_EXEC_PROBE)
+    exec_mode = exec_mode_probe ();
+  return exec_mode;
+}
+
 /* Map in a writable and executable chunk of memory if possible.
    Failing that, fall back to dlmmap_locked.  */
 static void *
 dlmmap (void *start, size_t length, int prot,
 	int flags, int fd, off_t offset)
 {
+  ffi_exec_mode mode = exec_mode_get ();
   void *ptr;
 
   assert (start == NULL && length % malloc_getpagesize == 0
@@ -825,13 +871,13 @@ dlmmap (void *start, size_t length, int prot,
 	  && flags == (MAP_PRIVATE | MAP_ANONYMOUS)
 	  && fd == -1 && offset == 0);
 
-  if (execfd == -1 && is_emutramp_enabled ())
+  if (execfd == -1 && mode == FFI_EXEC_EMUTRAMP)
     {
       ptr = mmap (start, length, prot & ~PROT_EXEC, flags, fd, offset);
       return ptr;
     }
 
-  if (execfd == -1 && !is_selinux_enabled ())
+  if (execfd == -1 && mode == FFI_EXEC_DIRECT)
     {
       ptr = mmap (start, length, prot | PROT_EXEC, flags, fd, offset);
 
@@ -896,6 +942,106 @@ segment_holding_code (mstate m, char* addr)
 }
 #endif
 
+#define CLOSURE_HEAP_RESERVE 1
+
+/* A child inherits the temporary file and the segments mapped from it
+   with MAP_SHARED, so anything it writes there, including closures
+   prepared in chunks the parent considers free, is seen by the parent
+   and by its other children.  On fork, the child copies each such
+   segment into a file of its own and maps the copy at the same
+   addresses, so inherited closures keep working.  The copy cannot be
+   put off until the child's first allocation: inherited closures are
+   also written through ffi_closure_retarget and through user_data.  */
+
+static void
+exec_atfork_prepare (void)
+{
+  (void) PREACTION (gm);
+  pthread_mutex_lock (&open_temp_exec_file_mutex);
+}
+
+static void
+exec_atfork_parent (void)
+{
+  pthread_mutex_unlock (&open_temp_exec_file_mutex);
+  POSTACTION (gm);
+}
+
+static void
+exec_atfork_child (void)
+{
+  msegmentptr sp;
+
+  if (execfd != -1)
+    close (execfd);
+  execfd = -1;
+  execsize = 0;
+
+  for (sp = &gm->seg; sp != 0; sp = sp->next)
+    {
+      char *code = add_segment_exec_offset (sp->base, sp);
+      char *ptr, *ptr_code;
+      off_t offset;
+
+      if (sp->base == 0 || code == sp->base)
+	continue;
+
+      /* Map the copy somewhere else first, so that a file that cannot
+	 be mapped for execution is found before the old views go.  */
+      ptr = dlmmap_locked (NULL, sp->size, PROT_READ | PROT_WRITE,
+			   MAP_PRIVATE | MAP_ANONYMOUS, 0);
+      /* A segment left shared would hand the child chunks the parent
+	 also uses, so give up rather than go on.  */
+      if (ptr == MFAIL)
+	abort ();
+      ptr_code = ptr + mmap_exec_offset (ptr, sp->size);
+      offset = execsize - sp->size;
+      memcpy (ptr, sp->base, sp->size);
+
+      if (mmap (code, sp->size, PROT_READ | PROT_EXEC, MAP_SHARED | MAP_FIXED,
+		execfd, offset) == MFAIL
+	  || mmap (sp->base, sp->size, PROT_READ | PROT_WRITE,
+		   MAP_SHARED | MAP_FIXED, execfd, offset) == MFAIL)
+	abort ();
+      munmap (ptr_code, sp->size);
+      munmap (ptr, sp->size);
+    }
+
+  exec_atfork_parent ();
+}
+
+/* Called with open_temp_exec_file_mutex held, once the first
+   temporary file is open.  */
+static void
+exec_atfork_register (void)
+{
+  static int registered;
+
+  if (!registered)
+    registered = pthread_atfork (exec_atfork_prepare, exec_atfork_parent,
+				 exec_atfork_child) == 0;
+}
+
+/* Map enough closure memory now that SIZE bytes can be allocated
+   later without mapping more, and keep it from being trimmed.  */
+int
+ffi_closure_reserve (size_t size)
+{
+  void *ptr;
+
+  if (size > (size_t) INT_MAX / 2)
+    return -1;
+  init_mparams ();
+  if (mparams.trim_threshold < size * 2)
+    dlmallopt (M_TRIM_THRESHOLD, (int) (size * 2));
+
+  ptr = dlmalloc (size);
+  if (ptr == NULL)
+    return -1;
+  dlfree (ptr);
+  return 0;
+}
+
 #endif /* !(defined(X86_WIN32) || defined(X86_WIN64) || defined(__OS2__)) || defined (__CYGWIN__) || defined(__INTERIX) */
 
 /* Allocate a chunk of memory with the given size.  Returns a pointer
@@ -964,3 +1110,13 @@ ffi_closure_free (void *ptr)
 #endif /* FFI_CLOSURES */
 
 #endif /* NetBSD with PROT_MPROTECT */
+
+#if FFI_CLOSURES && !defined CLOSURE_HEAP_RESERVE
+/* Other allocators keep no shared heap that could be reserved.  */
+int
+ffi_closure_reserve (size_t size)
+{
+  (void) size;
+  return 0;
+}
+#endif
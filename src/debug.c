@@ -54,9 +54,10 @@ void ffi_type_test(ffi_type *a, char *file, int line)
   FFI_ASSERT_AT(a->type <= FFI_TYPE_LAST, file, line);
   FFI_ASSERT_AT(a->type == FFI_TYPE_VOID || a->size > 0, file, line);
   FFI_ASSERT_AT(a->type == FFI_TYPE_VOID || a->alignment > 0, file, line);
-  FFI_ASSERT_AT((a->type != FFI_TYPE_STRUCT && a->type != FFI_TYPE_COMPLEX)
+  FFI_ASSERT_AT((a->type != FFI_TYPE_STRUCT && a->type != FFI_TYPE_COMPLEX
+		 && a->type != FFI_TYPE_VECTOR)
 		|| a->elements != NULL, file, line);
-  FFI_ASSERT_AT(a->type != FFI_TYPE_COMPLEX
+  FFI_ASSERT_AT((a->type != FFI_TYPE_COMPLEX && a->type != FFI_TYPE_ARRAY)
 		|| (a->elements != NULL
 		    && a->elements[0] != NULL && a->elements[1] == NULL),
 		file, line);
@@ -762,7 +762,8 @@ ffi_prep_closure_loc (ffi_closure *closure,
   closure->user_data = user_data;
 
 #ifdef USE__BUILTIN___CLEAR_CACHE
-  __builtin___clear_cache(clear_location, clear_location + FFI_TRAMPOLINE_SIZE);
+  ffi_closure_flush_range (clear_location,
+			   clear_location + FFI_TRAMPOLINE_SIZE);
 #else
   cacheflush (clear_location, FFI_TRAMPOLINE_SIZE, ICACHE);
 #endif
@@ -152,7 +152,7 @@ ffi_prep_cif_linux64_core (ffi_cif *cif)
       flags |= FLAG_RETURNS_FP;
       break;
 
-    case FFI_TYPE_UINT128:
+    case FFI_PPC_TYPE_UINT128:
       flags |= FLAG_RETURNS_128BITS;
       /* Fall through.  */
     case FFI_TYPE_UINT64:
@@ -76,7 +76,7 @@ translate_float (int abi, int type)
 	type = FFI_TYPE_UINT64;
 #if FFI_TYPE_LONGDOUBLE != FFI_TYPE_DOUBLE
       else if (type == FFI_TYPE_LONGDOUBLE)
-	type = FFI_TYPE_UINT128;
+	type = FFI_PPC_TYPE_UINT128;
     }
   else if ((abi & FFI_SYSV_IBM_LONG_DOUBLE) == 0)
     {
@@ -138,7 +138,7 @@ ffi_prep_cif_sysv_core (ffi_cif *cif)
 #endif
       break;
 
-    case FFI_TYPE_UINT128:
+    case FFI_PPC_TYPE_UINT128:
       flags |= FLAG_RETURNS_128BITS;
       /* Fall through.  */
     case FFI_TYPE_UINT64:
@@ -222,7 +222,7 @@ ffi_prep_cif_sysv_core (ffi_cif *cif)
 #endif
 	  break;
 
-	case FFI_TYPE_UINT128:
+	case FFI_PPC_TYPE_UINT128:
 	  /* A long double in FFI_LINUX_SOFT_FLOAT can use only a set
 	     of four consecutive gprs. If we do not have enough, we
 	     have to adjust the gpr_count value.  */
@@ -516,7 +516,7 @@ ffi_prep_args_SYSV (extended_cif *ecif, unsigned *const stack)
 	  break;
 #endif /* have FPRs */
 
-	case FFI_TYPE_UINT128:
+	case FFI_PPC_TYPE_UINT128:
 	  /* The soft float ABI for long doubles works like this, a long double
 	     is passed in four consecutive GPRs if available.  A maximum of 2
 	     long doubles can be passed in gprs.  If we do not have 4 GPRs
@@ -785,7 +785,7 @@ ffi_closure_helper_SYSV (ffi_cif *cif,
 # endif
 #endif
 
-      case FFI_TYPE_UINT128:
+      case FFI_PPC_TYPE_UINT128:
 	/* Test if for the whole long double, 4 gprs are available.
 	   otherwise the stuff ends up on the stack.  */
 	if (ng < NUM_GPR_ARG_REGISTERS - 3)
@@ -155,13 +155,17 @@ typedef enum ffi_abi {
    ppc_closure.S and linux64_closure.S be extended.  */
 
 #if !(FFI_TYPE_LAST == FFI_PPC_TYPE_LAST		\
-      || (FFI_TYPE_LAST == FFI_TYPE_COMPLEX		\
-	  && !defined FFI_TARGET_HAS_COMPLEX_TYPE))
+      || (FFI_TYPE_LAST == FFI_TYPE_ARRAY		\
+	  && !defined FFI_TARGET_HAS_COMPLEX_TYPE	\
+	  && !defined FFI_TARGET_HAS_VECTOR_TYPE	\
+	  && !defined FFI_TARGET_HAS_INT128_TYPE	\
+	  && !defined FFI_TARGET_HAS_FLOAT16_TYPE	\
+	  && !defined FFI_TARGET_HAS_ARRAY_TYPE))
 # error "You likely have a broken powerpc libffi"
 #endif
 
 /* Needed for soft-float long-double-128 support.  */
-#define FFI_TYPE_UINT128 (FFI_PPC_TYPE_LAST + 1)
+#define FFI_PPC_TYPE_UINT128 (FFI_PPC_TYPE_LAST + 1)
 
 /* Needed for FFI_SYSV small structure returns.  */
 #define FFI_SYSV_TYPE_SMALL_STRUCT (FFI_PPC_TYPE_LAST + 2)
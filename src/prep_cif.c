@@ -26,11 +26,49 @@
 #include <ffi.h>
 #include <ffi_common.h>
 #include <stdlib.h>
+#include <string.h>
 
 /* Round up to FFI_SIZEOF_ARG. */
 
 #define STACK_ARG_SIZE(x) FFI_ALIGN(x, FFI_SIZEOF_ARG)
 
+#ifdef FFI_TARGET_HAS_VECTOR_TYPE
+/* Finish the layout of a vector type, whose elements list names the
+   element type once per lane.  All lanes must be the same integer or
+   floating point type, the total size must be a power of two, and the
+   vector is aligned to its size.  Whether a given width can actually
+   be passed is left to the target.  */
+
+static ffi_status initialize_vector(ffi_type *arg)
+{
+  ffi_type **ptr = arg->elements;
+  ffi_type *lane = ptr[0];
+
+  switch (lane->type)
+    {
+    case FFI_TYPE_STRUCT:
+    case FFI_TYPE_COMPLEX:
+    case FFI_TYPE_VECTOR:
+    case FFI_TYPE_ARRAY:
+    case FFI_TYPE_VOID:
+    case FFI_TYPE_POINTER:
+      return FFI_BAD_TYPEDEF;
+    }
+  if (lane->type == FFI_TYPE_LONGDOUBLE && lane->size != sizeof (double))
+    return FFI_BAD_TYPEDEF;
+
+  for (; *ptr != NULL; ptr++)
+    if (*ptr != lane && (*ptr)->type != lane->type)
+      return FFI_BAD_TYPEDEF;
+
+  if (arg->size == 0 || (arg->size & (arg->size - 1)) != 0)
+    return FFI_BAD_TYPEDEF;
+
+  arg->alignment = (unsigned short) arg->size;
+  return FFI_OK;
+}
+#endif
+
 /* Perform machine independent initialization of aggregate type
    specifications. */
 
@@ -41,6 +79,11 @@ static ffi_status initialize_aggregate(ffi_type *arg, size_t *offsets)
   if (UNLIKELY(arg == NULL || arg->elements == NULL))
     return FFI_BAD_TYPEDEF;
 
+  /* Arrays are laid out by ffi_prep_array_type, since the element
+     count is only known from the final size.  */
+  if (UNLIKELY(arg->type == FFI_TYPE_ARRAY))
+    return FFI_BAD_TYPEDEF;
+
   arg->size = 0;
   arg->alignment = 0;
 
@@ -55,6 +98,11 @@ static ffi_status initialize_aggregate(ffi_type *arg, size_t *offsets)
 		    && (initialize_aggregate((*ptr), NULL) != FFI_OK)))
 	return FFI_BAD_TYPEDEF;
 
+#ifndef FFI_TARGET_HAS_ARRAY_TYPE
+      if (UNLIKELY((*ptr)->type == FFI_TYPE_ARRAY))
+	return FFI_BAD_TYPEDEF;
+#endif
+
       /* Perform a sanity check on the argument type */
       FFI_ASSERT_VALID_TYPE(*ptr);
 
@@ -78,6 +126,13 @@ static ffi_status initialize_aggregate(ffi_type *arg, size_t *offsets)
      total size of 3*sizeof(long).  */
   arg->size = FFI_ALIGN (arg->size, arg->alignment);
 
+  if (arg->type == FFI_TYPE_VECTOR)
+#ifdef FFI_TARGET_HAS_VECTOR_TYPE
+    return initialize_vector (arg);
+#else
+    return FFI_BAD_TYPEDEF;
+#endif
+
   /* On some targets, the ABI defines that structures have an additional
      alignment beyond the "natural" one based on their elements.  */
 #ifdef FFI_AGGREGATE_ALIGNMENT
@@ -96,6 +151,74 @@ static ffi_status initialize_aggregate(ffi_type *arg, size_t *offsets)
    alignment only, so it completely overrides this functions,
    which assumes "natural" alignment and padding.  */
 
+/* Initialize and check the N argument types at PTR, and add the stack
+   space they need to *PBYTES.  */
+
+static ffi_status
+initialize_args (ffi_type **ptr, unsigned int n, unsigned *pbytes)
+{
+  unsigned bytes = *pbytes;
+
+  for (; n > 0; n--, ptr++)
+    {
+      /* Initialize any uninitialized aggregate type definitions */
+      if (((*ptr)->size == 0)
+	  && (initialize_aggregate((*ptr), NULL) != FFI_OK))
+	return FFI_BAD_TYPEDEF;
+
+#ifndef FFI_TARGET_HAS_COMPLEX_TYPE
+      if ((*ptr)->type == FFI_TYPE_COMPLEX)
+	abort();
+#endif
+#ifndef FFI_TARGET_HAS_VECTOR_TYPE
+      if ((*ptr)->type == FFI_TYPE_VECTOR)
+	return FFI_BAD_TYPEDEF;
+#endif
+#ifndef FFI_TARGET_HAS_INT128_TYPE
+      if ((*ptr)->type == FFI_TYPE_UINT128
+	  || (*ptr)->type == FFI_TYPE_SINT128)
+	return FFI_BAD_TYPEDEF;
+#endif
+#ifndef FFI_TARGET_HAS_FLOAT16_TYPE
+      if ((*ptr)->type == FFI_TYPE_FLOAT16
+	  || (*ptr)->type == FFI_TYPE_BFLOAT16)
+	return FFI_BAD_TYPEDEF;
+#endif
+      if ((*ptr)->type == FFI_TYPE_ARRAY)
+	return FFI_BAD_TYPEDEF;
+      /* Perform a sanity check on the argument type, do this
+	 check after the initialization.  */
+      FFI_ASSERT_VALID_TYPE(*ptr);
+
+#if !defined FFI_TARGET_SPECIFIC_STACK_SPACE_ALLOCATION
+	{
+	  /* Add any padding if necessary */
+	  if (((*ptr)->alignment - 1) & bytes)
+	    bytes = (unsigned)FFI_ALIGN(bytes, (*ptr)->alignment);
+
+#ifdef TILE
+	  if (bytes < 10 * FFI_SIZEOF_ARG &&
+	      bytes + STACK_ARG_SIZE((*ptr)->size) > 10 * FFI_SIZEOF_ARG)
+	    {
+	      /* An argument is never split between the 10 parameter
+		 registers and the stack.  */
+	      bytes = 10 * FFI_SIZEOF_ARG;
+	    }
+#endif
+#ifdef XTENSA
+	  if (bytes <= 6*4 && bytes + STACK_ARG_SIZE((*ptr)->size) > 6*4)
+	    bytes = 6*4;
+#endif
+
+	  bytes += STACK_ARG_SIZE((*ptr)->size);
+	}
+#endif
+    }
+
+  *pbytes = bytes;
+  return FFI_OK;
+}
+
 /* Perform machine independent ffi_cif preparation, then call
    machine dependent routine. */
 
@@ -106,19 +229,12 @@ static ffi_status initialize_aggregate(ffi_type *arg, size_t *offsets)
    and ntotalargs set as appropriate. nfixedargs must always be >=1 */
 
 
-ffi_status FFI_HIDDEN ffi_prep_cif_core(ffi_cif *cif, ffi_abi abi,
-			     unsigned int isvariadic,
-                             unsigned int nfixedargs,
-                             unsigned int ntotalargs,
-			     ffi_type *rtype, ffi_type **atypes)
+static ffi_status
+initialize_cif (ffi_cif *cif, ffi_abi abi, unsigned int ntotalargs,
+		ffi_type *rtype, ffi_type **atypes)
 {
   unsigned bytes = 0;
-  unsigned int i;
-  ffi_type **ptr;
-
-  FFI_ASSERT(cif != NULL);
-  FFI_ASSERT((!isvariadic) || (nfixedargs >= 1));
-  FFI_ASSERT(nfixedargs <= ntotalargs);
+  ffi_status status;
 
   if (! (abi > FFI_FIRST_ABI && abi < FFI_LAST_ABI))
     return FFI_BAD_ABI;
@@ -143,6 +259,20 @@ ffi_status FFI_HIDDEN ffi_prep_cif_core(ffi_cif *cif, ffi_abi abi,
   if (rtype->type == FFI_TYPE_COMPLEX)
     abort();
 #endif
+#ifndef FFI_TARGET_HAS_VECTOR_TYPE
+  if (rtype->type == FFI_TYPE_VECTOR)
+    return FFI_BAD_TYPEDEF;
+#endif
+#ifndef FFI_TARGET_HAS_INT128_TYPE
+  if (rtype->type == FFI_TYPE_UINT128 || rtype->type == FFI_TYPE_SINT128)
+    return FFI_BAD_TYPEDEF;
+#endif
+#ifndef FFI_TARGET_HAS_FLOAT16_TYPE
+  if (rtype->type == FFI_TYPE_FLOAT16 || rtype->type == FFI_TYPE_BFLOAT16)
+    return FFI_BAD_TYPEDEF;
+#endif
+  if (rtype->type == FFI_TYPE_ARRAY)
+    return FFI_BAD_TYPEDEF;
   /* Perform a sanity check on the return type */
   FFI_ASSERT_VALID_TYPE(cif->rtype);
 
@@ -163,48 +293,29 @@ ffi_status FFI_HIDDEN ffi_prep_cif_core(ffi_cif *cif, ffi_abi abi,
     bytes = STACK_ARG_SIZE(sizeof(void*));
 #endif
 
-  for (ptr = cif->arg_types, i = cif->nargs; i > 0; i--, ptr++)
-    {
-
-      /* Initialize any uninitialized aggregate type definitions */
-      if (((*ptr)->size == 0)
-	  && (initialize_aggregate((*ptr), NULL) != FFI_OK))
-	return FFI_BAD_TYPEDEF;
-
-#ifndef FFI_TARGET_HAS_COMPLEX_TYPE
-      if ((*ptr)->type == FFI_TYPE_COMPLEX)
-	abort();
-#endif
-      /* Perform a sanity check on the argument type, do this
-	 check after the initialization.  */
-      FFI_ASSERT_VALID_TYPE(*ptr);
+  status = initialize_args (cif->arg_types, cif->nargs, &bytes);
+  if (status != FFI_OK)
+    return status;
 
-#if !defined FFI_TARGET_SPECIFIC_STACK_SPACE_ALLOCATION
-	{
-	  /* Add any padding if necessary */
-	  if (((*ptr)->alignment - 1) & bytes)
-	    bytes = (unsigned)FFI_ALIGN(bytes, (*ptr)->alignment);
+  cif->bytes = bytes;
+  return FFI_OK;
+}
 
-#ifdef TILE
-	  if (bytes < 10 * FFI_SIZEOF_ARG &&
-	      bytes + STACK_ARG_SIZE((*ptr)->size) > 10 * FFI_SIZEOF_ARG)
-	    {
-	      /* An argument is never split between the 10 parameter
-		 registers and the stack.  */
-	      bytes = 10 * FFI_SIZEOF_ARG;
-	    }
-#endif
-#ifdef XTENSA
-	  if (bytes <= 6*4 && bytes + STACK_ARG_SIZE((*ptr)->size) > 6*4)
-	    bytes = 6*4;
-#endif
+ffi_status FFI_HIDDEN ffi_prep_cif_core(ffi_cif *cif, ffi_abi abi,
+			     unsigned int isvariadic,
+                             unsigned int nfixedargs,
+                             unsigned int ntotalargs,
+			     ffi_type *rtype, ffi_type **atypes)
+{
+  ffi_status status;
 
-	  bytes += STACK_ARG_SIZE((*ptr)->size);
-	}
-#endif
-    }
+  FFI_ASSERT(cif != NULL);
+  FFI_ASSERT((!isvariadic) || (nfixedargs >= 1));
+  FFI_ASSERT(nfixedargs <= ntotalargs);
 
-  cif->bytes = bytes;
+  status = initialize_cif (cif, abi, ntotalargs, rtype, atypes);
+  if (status != FFI_OK)
+    return status;
 
   /* Perform machine dependent cif processing */
 #ifdef FFI_TARGET_SPECIFIC_VARIADIC
@@ -232,6 +343,74 @@ ffi_status ffi_prep_cif_var(ffi_cif *cif,
   return ffi_prep_cif_core(cif, abi, 1, nfixedargs, ntotalargs, rtype, atypes);
 }
 
+/* A variadic template keeps the stack space the fixed arguments need,
+   as computed above, and whatever state the target records after
+   assigning them.  Targets without such state prepare each call from
+   scratch.  */
+
+ffi_status
+ffi_prep_var_template (ffi_var_template *tmpl, ffi_abi abi,
+		       unsigned int nfixedargs, ffi_type *rtype,
+		       ffi_type **atypes)
+{
+#ifdef FFI_TARGET_HAS_VARIADIC_TAIL
+  ffi_status status;
+#endif
+
+  if (tmpl == NULL || nfixedargs == 0)
+    return FFI_BAD_TYPEDEF;
+  memset (tmpl, 0, sizeof (*tmpl));
+  tmpl->nfixedargs = nfixedargs;
+
+#ifdef FFI_TARGET_HAS_VARIADIC_TAIL
+  status = initialize_cif (&tmpl->cif, abi, nfixedargs, rtype, atypes);
+  if (status != FFI_OK)
+    return status;
+  tmpl->bytes = tmpl->cif.bytes;
+#ifdef FFI_TARGET_SPECIFIC_VARIADIC
+  status = ffi_prep_cif_machdep_var (&tmpl->cif, nfixedargs, nfixedargs);
+#else
+  status = ffi_prep_cif_machdep (&tmpl->cif);
+#endif
+  if (status != FFI_OK)
+    return status;
+  return ffi_prep_var_template_machdep (tmpl);
+#else
+  return ffi_prep_cif_var (&tmpl->cif, abi, nfixedargs, nfixedargs,
+			   rtype, atypes);
+#endif
+}
+
+ffi_status
+ffi_prep_cif_var_tail (ffi_cif *cif, const ffi_var_template *tmpl,
+		       unsigned int ntotalargs, ffi_type **atypes)
+{
+  unsigned int nfixedargs = tmpl->nfixedargs;
+#ifdef FFI_TARGET_HAS_VARIADIC_TAIL
+  unsigned bytes = tmpl->bytes;
+  ffi_status status;
+#endif
+
+  if (ntotalargs < nfixedargs || atypes == NULL)
+    return FFI_BAD_TYPEDEF;
+
+#ifdef FFI_TARGET_HAS_VARIADIC_TAIL
+  status = initialize_args (atypes + nfixedargs, ntotalargs - nfixedargs,
+			    &bytes);
+  if (status != FFI_OK)
+    return status;
+
+  *cif = tmpl->cif;
+  cif->arg_types = atypes;
+  cif->nargs = ntotalargs;
+  cif->bytes = bytes;
+  return ffi_prep_cif_machdep_var_tail (cif, tmpl);
+#else
+  return ffi_prep_cif_core (cif, tmpl->cif.abi, 1, nfixedargs, ntotalargs,
+			    tmpl->cif.rtype, atypes);
+#endif
+}
+
 #if FFI_CLOSURES
 
 ffi_status
@@ -259,3 +438,26 @@ ffi_get_struct_offsets (ffi_abi abi, ffi_type *struct_type, size_t *offsets)
 
   return initialize_aggregate(struct_type, offsets);
 }
+
+ffi_status
+ffi_prep_array_type (ffi_type *array_type, size_t count)
+{
+  ffi_type *element;
+
+  if (array_type->type != FFI_TYPE_ARRAY || array_type->elements == NULL)
+    return FFI_BAD_TYPEDEF;
+
+  element = array_type->elements[0];
+  if (element == NULL || array_type->elements[1] != NULL
+      || element->type == FFI_TYPE_VOID || count == 0)
+    return FFI_BAD_TYPEDEF;
+
+  if (element->size == 0 && initialize_aggregate (element, NULL) != FFI_OK)
+    return FFI_BAD_TYPEDEF;
+  if (count > (size_t) -1 / element->size)
+    return FFI_BAD_TYPEDEF;
+
+  array_type->size = element->size * count;
+  array_type->alignment = element->alignment;
+  return FFI_OK;
+}
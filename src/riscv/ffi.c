@@ -63,6 +63,10 @@ typedef struct call_builder
     size_t *used_stack;
 } call_builder;
 
+/* struct classifications cached in the cif, see fsi_store */
+#define FSI_SLOTS 8
+#define FSI_UNKNOWN 0xff
+
 /* integer (not pointer) less than ABI XLEN */
 /* FFI_TYPE_INT does not appear to be used */
 #if __SIZEOF_POINTER__ == 8
@@ -126,11 +130,93 @@ static float_struct_info struct_passed_as_elements(call_builder *cb, ffi_type *t
 
     return ret;
 }
+
+/* The classification of the return type and of the first fixed struct
+   arguments is worked out by ffi_prep_cif_machdep and kept in the cif,
+   a byte per struct: slot 0 for the return type and slots 1 onwards
+   for the struct arguments in order, the first four in cif->flags and
+   the rest in cif->riscv_unused.  A byte holds type1 in its low half
+   and type2 in its high half, or 0 for a struct not passed as
+   elements; offset2 follows from the two types.  FSI_UNKNOWN marks a
+   struct that has to be classified at call time.  */
+static int atom_size(int type) {
+    switch (type) {
+        case FFI_TYPE_UINT8: case FFI_TYPE_SINT8: return 1;
+        case FFI_TYPE_UINT16: case FFI_TYPE_SINT16: return 2;
+        case FFI_TYPE_FLOAT: case FFI_TYPE_UINT32: case FFI_TYPE_SINT32: return 4;
+        default: return 8;
+    }
+}
+
+static float_struct_info fsi_decode(unsigned code) {
+    float_struct_info ret = {0, 0, 0, 0};
+    if (code) {
+        ret.as_elements = 1;
+        ret.type1 = code & 15;
+        ret.type2 = code >> 4;
+        if (ret.type2)
+            ret.offset2 = FFI_ALIGN(atom_size(ret.type1), atom_size(ret.type2));
+    }
+    return ret;
+}
+
+static unsigned fsi_encode(float_struct_info fsi) {
+    unsigned code = fsi.as_elements ? (fsi.type1 | fsi.type2 << 4) : 0;
+    float_struct_info check = fsi_decode(code);
+
+    /* Structs whose members are not laid out naturally are left for
+       call time.  */
+    if (memcmp(&check, &fsi, sizeof(fsi)) != 0)
+        return FSI_UNKNOWN;
+    return code;
+}
+
+static unsigned fsi_load(const ffi_cif *cif, int slot) {
+    unsigned word = slot < 4 ? cif->flags : cif->riscv_unused;
+    return (word >> (8 * (slot & 3))) & 0xff;
+}
+
+static void fsi_store(ffi_cif *cif, int slot, unsigned code) {
+    unsigned *word = slot < 4 ? &cif->flags : &cif->riscv_unused;
+    int shift = 8 * (slot & 3);
+    *word = (*word & ~(0xffu << shift)) | code << shift;
+}
 #endif
 
+/* The cached classification for an argument of TYPE, or FSI_UNKNOWN.
+   *PSLOT is the slot of the next fixed struct argument.  */
+static unsigned fsi_next(const ffi_cif *cif, ffi_type *type, int var, int *pslot) {
+#if ABI_FLEN
+    if (!var && type->type == FFI_TYPE_STRUCT && *pslot < FSI_SLOTS)
+        return fsi_load(cif, (*pslot)++);
+#endif
+    return FSI_UNKNOWN;
+}
+
 /* allocates a single register, float register, or XLEN-sized stack slot to a datum */
 static void marshal_atom(call_builder *cb, int type, void *data) {
     size_t value = 0;
+
+    /* without registers, only count what would be used */
+    if (cb->aregs == NULL) {
+#if ABI_FLEN >= 64
+        if (type == FFI_TYPE_FLOAT || type == FFI_TYPE_DOUBLE) {
+            cb->used_float++;
+            return;
+        }
+#elif ABI_FLEN >= 32
+        if (type == FFI_TYPE_FLOAT) {
+            cb->used_float++;
+            return;
+        }
+#endif
+        if (cb->used_integer == NARGREG)
+            cb->used_stack++;
+        else
+            cb->used_integer++;
+        return;
+    }
+
     switch (type) {
         case FFI_TYPE_UINT8: value = *(uint8_t *)data; break;
         case FFI_TYPE_SINT8: value = *(int8_t *)data; break;
@@ -205,13 +291,15 @@ static void unmarshal_atom(call_builder *cb, int type, void *data) {
     }
 }
 
-/* adds an argument to a call, or a not by reference return value */
-static void marshal(call_builder *cb, ffi_type *type, int var, void *data) {
+/* adds an argument to a call, or a not by reference return value; CODE
+   is the cached classification of a struct argument, if known */
+static void marshal(call_builder *cb, ffi_type *type, int var, void *data, unsigned code) {
     size_t realign[2];
 
 #if ABI_FLEN
     if (!var && type->type == FFI_TYPE_STRUCT) {
-        float_struct_info fsi = struct_passed_as_elements(cb, type);
+        float_struct_info fsi = code != FSI_UNKNOWN ? fsi_decode(code)
+            : struct_passed_as_elements(cb, type);
         if (fsi.as_elements) {
             marshal_atom(cb, fsi.type1, data);
             if (fsi.offset2)
@@ -242,7 +330,8 @@ static void marshal(call_builder *cb, ffi_type *type, int var, void *data) {
             cb->used_stack = (size_t *)FFI_ALIGN(cb->used_stack, 2*__SIZEOF_POINTER__);
         }
 
-        memcpy(realign, data, type->size);
+        if (data)
+            memcpy(realign, data, type->size);
         if (type->size > 0)
             marshal_atom(cb, FFI_TYPE_POINTER, realign);
         if (type->size > __SIZEOF_POINTER__)
@@ -251,13 +340,14 @@ static void marshal(call_builder *cb, ffi_type *type, int var, void *data) {
 }
 
 /* for arguments passed by reference returns the pointer, otherwise the arg is copied (up to MAXCOPYARG bytes) */
-static void *unmarshal(call_builder *cb, ffi_type *type, int var, void *data) {
+static void *unmarshal(call_builder *cb, ffi_type *type, int var, void *data, unsigned code) {
     size_t realign[2];
     void *pointer;
 
 #if ABI_FLEN
     if (!var && type->type == FFI_TYPE_STRUCT) {
-        float_struct_info fsi = struct_passed_as_elements(cb, type);
+        float_struct_info fsi = code != FSI_UNKNOWN ? fsi_decode(code)
+            : struct_passed_as_elements(cb, type);
         if (fsi.as_elements) {
             unmarshal_atom(cb, fsi.type1, data);
             if (fsi.offset2)
@@ -299,10 +389,11 @@ static void *unmarshal(call_builder *cb, ffi_type *type, int var, void *data) {
     }
 }
 
-static int passed_by_ref(call_builder *cb, ffi_type *type, int var) {
+static int passed_by_ref(call_builder *cb, ffi_type *type, int var, unsigned code) {
 #if ABI_FLEN
     if (!var && type->type == FFI_TYPE_STRUCT) {
-        float_struct_info fsi = struct_passed_as_elements(cb, type);
+        float_struct_info fsi = code != FSI_UNKNOWN ? fsi_decode(code)
+            : struct_passed_as_elements(cb, type);
         if (fsi.as_elements) return 0;
     }
 #endif
@@ -310,17 +401,62 @@ static int passed_by_ref(call_builder *cb, ffi_type *type, int var) {
     return type->size > 2 * __SIZEOF_POINTER__;
 }
 
+/* Classify the return value and the arguments once, the way ffi_call
+   will, keeping the result for the struct arguments and the exact
+   size of the stacked arguments */
+static ffi_status riscv_prep_args(ffi_cif *cif) {
+    size_t base[2] __attribute__((aligned(STKALIGN)));
+    call_builder cb;
+    unsigned code = FSI_UNKNOWN;
+    int i;
+#if ABI_FLEN
+    int slot = 1;
+#endif
+
+    cb.aregs = NULL;
+    cb.used_integer = cb.used_float = 0;
+    cb.used_stack = base;
+
+#if ABI_FLEN
+    cif->flags = cif->riscv_unused = ~0u;
+    if (cif->rtype->type == FFI_TYPE_STRUCT) {
+        code = fsi_encode(struct_passed_as_elements(&cb, cif->rtype));
+        fsi_store(cif, 0, code);
+    }
+#endif
+
+    if (passed_by_ref(&cb, cif->rtype, 0, code))
+        marshal(&cb, &ffi_type_pointer, 0, NULL, FSI_UNKNOWN);
+
+    for (i = 0; i < cif->nargs; i++) {
+        ffi_type *type = cif->arg_types[i];
+        int var = i >= cif->riscv_nfixedargs;
+
+        code = FSI_UNKNOWN;
+#if ABI_FLEN
+        if (!var && type->type == FFI_TYPE_STRUCT && slot < FSI_SLOTS) {
+            code = fsi_encode(struct_passed_as_elements(&cb, type));
+            fsi_store(cif, slot++, code);
+        }
+#endif
+        marshal(&cb, type, var, NULL, code);
+    }
+
+    cif->bytes = FFI_ALIGN((char *)cb.used_stack - (char *)base, STKALIGN);
+    return FFI_OK;
+}
+
 /* Perform machine dependent cif processing */
 ffi_status ffi_prep_cif_machdep(ffi_cif *cif) {
     cif->riscv_nfixedargs = cif->nargs;
-    return FFI_OK;
+    return riscv_prep_args(cif);
 }
 
 /* Perform machine dependent cif processing when we have a variadic function */
 
 ffi_status ffi_prep_cif_machdep_var(ffi_cif *cif, unsigned int nfixedargs, unsigned int ntotalargs) {
     cif->riscv_nfixedargs = nfixedargs;
-    return FFI_OK;
+    return riscv_prep_args(cif);
 }
 
 /* Low level routine for calling functions */
@@ -328,10 +464,7 @@ extern void ffi_call_asm(void *stack, struct call_context *regs, void (*fn)(void
 
 void ffi_call(ffi_cif *cif, void (*fn)(void), void *rvalue, void **avalue)
 {
-    /* this is a conservative estimate, assuming a complex return value and
-       that all remaining arguments are long long / __int128 */
-    size_t arg_bytes = cif->nargs <= 3 ? 0 :
-        FFI_ALIGN(2 * sizeof(size_t) * (cif->nargs - 3), STKALIGN);
+    size_t arg_bytes = cif->bytes;
     size_t rval_bytes = 0;
     if (rvalue == NULL && cif->rtype->size > 2*__SIZEOF_POINTER__)
         rval_bytes = FFI_ALIGN(cif->rtype->size, STKALIGN);
@@ -358,19 +491,25 @@ void ffi_call(ffi_cif *cif, void (*fn)(void), void *rvalue, void **avalue)
     cb.aregs = (call_context*)(alloc_base + arg_bytes + rval_bytes);
     cb.used_stack = (void*)alloc_base;
 
-    int return_by_ref = passed_by_ref(&cb, cif->rtype, 0);
+    int slot = 0;
+    unsigned rcode = fsi_next(cif, cif->rtype, 0, &slot);
+    int return_by_ref = passed_by_ref(&cb, cif->rtype, 0, rcode);
     if (return_by_ref)
-        marshal(&cb, &ffi_type_pointer, 0, &rvalue);
+        marshal(&cb, &ffi_type_pointer, 0, &rvalue, FSI_UNKNOWN);
 
     int i;
-    for (i = 0; i < cif->nargs; i++)
-        marshal(&cb, cif->arg_types[i], i >= cif->riscv_nfixedargs, avalue[i]);
+    slot = 1;
+    for (i = 0; i < cif->nargs; i++) {
+        ffi_type *type = cif->arg_types[i];
+        int var = i >= cif->riscv_nfixedargs;
+        marshal(&cb, type, var, avalue[i], fsi_next(cif, type, var, &slot));
+    }
 
     ffi_call_asm((void*)alloc_base, cb.aregs, fn);
 
     cb.used_float = cb.used_integer = 0;
     if (!return_by_ref && rvalue)
-        unmarshal(&cb, cif->rtype, 0, rvalue);
+        unmarshal(&cb, cif->rtype, 0, rvalue, rcode);
 }
 
 extern void ffi_closure_asm(void) FFI_HIDDEN;
@@ -401,7 +540,7 @@ ffi_status ffi_prep_closure_loc(ffi_closure *closure, ffi_cif *cif, void (*fun)(
     closure->fun = fun;
     closure->user_data = user_data;
 
-    __builtin___clear_cache(codeloc, codeloc + FFI_TRAMPOLINE_SIZE);
+    ffi_closure_flush_range (codeloc, (char *) codeloc + FFI_TRAMPOLINE_SIZE);
 
     return FFI_OK;
 }
@@ -420,26 +559,32 @@ void FFI_HIDDEN ffi_closure_inner(size_t *stack, call_context *aregs, ffi_closur
     void *rvalue;
     call_builder cb;
     int return_by_ref;
-    int i;
+    int i, slot = 0;
+    unsigned rcode;
 
     cb.aregs = aregs;
     cb.used_integer = cb.used_float = 0;
     cb.used_stack = stack;
 
-    return_by_ref = passed_by_ref(&cb, cif->rtype, 0);
+    rcode = fsi_next(cif, cif->rtype, 0, &slot);
+    return_by_ref = passed_by_ref(&cb, cif->rtype, 0, rcode);
     if (return_by_ref)
-        unmarshal(&cb, &ffi_type_pointer, 0, &rvalue);
+        unmarshal(&cb, &ffi_type_pointer, 0, &rvalue, FSI_UNKNOWN);
     else
         rvalue = alloca(cif->rtype->size);
 
-    for (i = 0; i < cif->nargs; i++)
-        avalue[i] = unmarshal(&cb, cif->arg_types[i],
-            i >= cif->riscv_nfixedargs, astorage + i*MAXCOPYARG);
+    slot = 1;
+    for (i = 0; i < cif->nargs; i++) {
+        ffi_type *type = cif->arg_types[i];
+        int var = i >= cif->riscv_nfixedargs;
+        avalue[i] = unmarshal(&cb, type, var, astorage + i*MAXCOPYARG,
+            fsi_next(cif, type, var, &slot));
+    }
 
     (closure->fun)(cif, rvalue, avalue, closure->user_data);
 
     if (!return_by_ref && cif->rtype->type != FFI_TYPE_VOID) {
         cb.used_integer = cb.used_float = 0;
-        marshal(&cb, cif->rtype, 0, rvalue);
+        marshal(&cb, cif->rtype, 0, rvalue, rcode);
     }
 }
@@ -0,0 +1,330 @@
+/* -----------------------------------------------------------------------
+   signature.c - Prepare a cif from a textual signature.
+
+   Permission is hereby granted, free of charge, to any person obtaining
+   a copy of this software and associated documentation files (the
+   ``Software''), to deal in the Software without restriction, including
+   without limitation the rights to use, copy, modify, merge, publish,
+   distribute, sublicense, and/or sell copies of the Software, and to
+   permit persons to whom the Software is furnished to do so, subject to
+   the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED ``AS IS'', WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+   NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+   ----------------------------------------------------------------------- */
+
+#include <ffi.h>
+#include <ffi_common.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _MSC_VER
+#include <windows.h>
+#endif
+
+/* A signature is the return type followed by the parenthesised argument
+   types, for example "i(p{dd}i)".  Each signature is parsed twice: once
+   to count the structure nodes and element slots it needs, and once to
+   build them in a single allocation that also holds the prepared cif.
+   That allocation is entered into a hash table and never freed, so
+   later requests for the same signature and ABI only copy the cif.  */
+
+#define SIG_BUCKETS 256
+
+struct sig_entry
+{
+  struct sig_entry *next;
+  unsigned hash;
+  ffi_abi abi;
+  ffi_cif cif;
+  const char *sig;
+};
+
+static struct sig_entry *sig_table[SIG_BUCKETS];
+
+struct sig_parser
+{
+  const char *p;
+  ffi_type *types;		/* NULL while counting.  */
+  ffi_type **slots;
+  size_t ntypes;
+  size_t nslots;
+};
+
+static struct sig_entry *
+sig_load (struct sig_entry **bucket)
+{
+#ifdef _MSC_VER
+  return InterlockedCompareExchangePointer ((PVOID volatile *) bucket,
+					    NULL, NULL);
+#else
+  return __atomic_load_n (bucket, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static int
+sig_publish (struct sig_entry **bucket, struct sig_entry *head,
+	     struct sig_entry *e)
+{
+#ifdef _MSC_VER
+  return InterlockedCompareExchangePointer ((PVOID volatile *) bucket,
+					    e, head) == head;
+#else
+  return __atomic_compare_exchange_n (bucket, &head, e, 0,
+				      __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static ffi_type *
+sig_primitive (char c)
+{
+  switch (c)
+    {
+    case 'v': return &ffi_type_void;
+    case 'c': return &ffi_type_schar;
+    case 'C': return &ffi_type_uchar;
+    case 's': return &ffi_type_sshort;
+    case 'S': return &ffi_type_ushort;
+    case 'i': return &ffi_type_sint;
+    case 'I': return &ffi_type_uint;
+    case 'l': return &ffi_type_slong;
+    case 'L': return &ffi_type_ulong;
+    case 'q': return &ffi_type_sint64;
+    case 'Q': return &ffi_type_uint64;
+    case 'f': return &ffi_type_float;
+    case 'd': return &ffi_type_double;
+    case 'D': return &ffi_type_longdouble;
+    case 'p': return &ffi_type_pointer;
+    default: return NULL;
+    }
+}
+
+/* Count the types listed from P up to the CLOSE that ends the list,
+   without looking inside nested structures and arrays.  Returns -1 if
+   the list is not terminated.  */
+
+static long
+sig_count (const char *p, char close)
+{
+  long n = 0;
+  int depth = 0;
+
+  for (; *p; p++)
+    {
+      if (depth == 0 && *p == close)
+	return n;
+      if (*p == '{' || *p == '[')
+	{
+	  if (depth++ == 0)
+	    n++;
+	}
+      else if (*p == '}' || *p == ']')
+	depth--;
+      else if (depth == 0)
+	n++;
+      if (depth < 0)
+	return -1;
+    }
+  return -1;
+}
+
+static ffi_type *
+sig_new_type (struct sig_parser *ps)
+{
+  size_t i = ps->ntypes++;
+  return ps->types ? &ps->types[i] : NULL;
+}
+
+static ffi_type **
+sig_new_slots (struct sig_parser *ps, size_t n)
+{
+  size_t i = ps->nslots;
+  ps->nslots += n;
+  return ps->types ? &ps->slots[i] : NULL;
+}
+
+static ffi_status
+sig_parse_type (struct sig_parser *ps, ffi_type **out, int member)
+{
+  ffi_type *t, **elems;
+  long i, n;
+  char c = *ps->p++;
+
+  switch (c)
+    {
+    case '{':
+      n = sig_count (ps->p, '}');
+      if (n <= 0)
+	return FFI_BAD_TYPEDEF;
+      t = sig_new_type (ps);
+      elems = sig_new_slots (ps, n + 1);
+      for (i = 0; i < n; i++)
+	if (sig_parse_type (ps, elems ? &elems[i] : NULL, 1) != FFI_OK)
+	  return FFI_BAD_TYPEDEF;
+      if (*ps->p++ != '}')
+	return FFI_BAD_TYPEDEF;
+      if (t)
+	{
+	  t->size = 0;
+	  t->alignment = 0;
+	  t->type = FFI_TYPE_STRUCT;
+	  t->elements = elems;
+	  elems[n] = NULL;
+	}
+      break;
+
+    case '[':
+#ifdef FFI_TARGET_HAS_ARRAY_TYPE
+      {
+	size_t count = 0;
+
+	if (!member || *ps->p < '1' || *ps->p > '9')
+	  return FFI_BAD_TYPEDEF;
+	while (*ps->p >= '0' && *ps->p <= '9')
+	  {
+	    if (count > ((size_t) -1 - 9) / 10)
+	      return FFI_BAD_TYPEDEF;
+	    count = count * 10 + (*ps->p++ - '0');
+	  }
+	t = sig_new_type (ps);
+	elems = sig_new_slots (ps, 2);
+	if (sig_parse_type (ps, elems ? &elems[0] : NULL, 1) != FFI_OK
+	    || *ps->p++ != ']')
+	  return FFI_BAD_TYPEDEF;
+	if (t)
+	  {
+	    t->size = 0;
+	    t->alignment = 0;
+	    t->type = FFI_TYPE_ARRAY;
+	    t->elements = elems;
+	    elems[1] = NULL;
+	    if (ffi_prep_array_type (t, count) != FFI_OK)
+	      return FFI_BAD_TYPEDEF;
+	  }
+      }
+      break;
+#else
+      return FFI_BAD_TYPEDEF;
+#endif
+
+    default:
+      t = sig_primitive (c);
+      if (t == NULL || (member && t == &ffi_type_void))
+	return FFI_BAD_TYPEDEF;
+      break;
+    }
+
+  if (out)
+    *out = t;
+  return FFI_OK;
+}
+
+/* Parse the whole signature.  RTYPE and ATYPES are only written when
+   PS->types is set.  */
+
+static ffi_status
+sig_parse (struct sig_parser *ps, ffi_type **rtype, ffi_type **atypes,
+	   long *nargs)
+{
+  long i, n;
+
+  if (sig_parse_type (ps, rtype, 0) != FFI_OK || *ps->p++ != '(')
+    return FFI_BAD_TYPEDEF;
+  n = sig_count (ps->p, ')');
+  if (n < 0)
+    return FFI_BAD_TYPEDEF;
+  for (i = 0; i < n; i++)
+    {
+      if (*ps->p == 'v'
+	  || sig_parse_type (ps, atypes ? &atypes[i] : NULL, 0) != FFI_OK)
+	return FFI_BAD_TYPEDEF;
+    }
+  if (ps->p[0] != ')' || ps->p[1] != '\0')
+    return FFI_BAD_TYPEDEF;
+  *nargs = n;
+  return FFI_OK;
+}
+
+static unsigned
+sig_hash (const char *sig, ffi_abi abi)
+{
+  unsigned h = 2166136261u ^ (unsigned) abi;
+
+  for (; *sig; sig++)
+    h = (h ^ (unsigned char) *sig) * 16777619u;
+  return h;
+}
+
+ffi_status
+ffi_prep_cif_from_string (ffi_cif *cif, ffi_abi abi, const char *sig)
+{
+  struct sig_parser ps;
+  struct sig_entry **bucket, *e, *head;
+  ffi_type *rtype, **atypes;
+  ffi_status status;
+  size_t len, off_types, off_slots, off_sig;
+  unsigned hash;
+  long nargs;
+
+  if (cif == NULL || sig == NULL)
+    return FFI_BAD_TYPEDEF;
+
+  hash = sig_hash (sig, abi);
+  bucket = &sig_table[hash % SIG_BUCKETS];
+  for (e = sig_load (bucket); e; e = e->next)
+    if (e->hash == hash && e->abi == abi && strcmp (e->sig, sig) == 0)
+      {
+	*cif = e->cif;
+	return FFI_OK;
+      }
+
+  memset (&ps, 0, sizeof (ps));
+  ps.p = sig;
+  status = sig_parse (&ps, NULL, NULL, &nargs);
+  if (status != FFI_OK)
+    return status;
+
+  len = strlen (sig) + 1;
+  off_types = FFI_ALIGN (sizeof (struct sig_entry), FFI_SIZEOF_ARG);
+  off_slots = off_types + ps.ntypes * sizeof (ffi_type);
+  off_sig = off_slots + (ps.nslots + nargs) * sizeof (ffi_type *);
+  e = malloc (off_sig + len);
+  if (e == NULL)
+    return FFI_BAD_TYPEDEF;
+
+  atypes = (ffi_type **) ((char *) e + off_slots);
+  ps.p = sig;
+  ps.types = (ffi_type *) ((char *) e + off_types);
+  ps.slots = atypes + nargs;
+  ps.ntypes = ps.nslots = 0;
+  status = sig_parse (&ps, &rtype, atypes, &nargs);
+  if (status == FFI_OK)
+    status = ffi_prep_cif (&e->cif, abi, (unsigned) nargs, rtype, atypes);
+  if (status != FFI_OK)
+    {
+      free (e);
+      return status;
+    }
+
+  e->hash = hash;
+  e->abi = abi;
+  e->sig = memcpy ((char *) e + off_sig, sig, len);
+  do
+    {
+      head = sig_load (bucket);
+      e->next = head;
+    }
+  while (!sig_publish (bucket, head, e));
+
+  *cif = e->cif;
+  return FFI_OK;
+}
@@ -0,0 +1,211 @@
+/* -----------------------------------------------------------------------
+   stats.c - Per-cif call statistics.
+
+   Permission is hereby granted, free of charge, to any person obtaining
+   a copy of this software and associated documentation files (the
+   ``Software''), to deal in the Software without restriction, including
+   without limitation the rights to use, copy, modify, merge, publish,
+   distribute, sublicense, and/or sell copies of the Software, and to
+   permit persons to whom the Software is furnished to do so, subject to
+   the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED ``AS IS'', WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+   NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+   ----------------------------------------------------------------------- */
+
+#include <ffi.h>
+#include <ffi_common.h>
+
+#if FFI_STATS
+
+#include <time.h>
+
+/* Counters live in a fixed-size side table keyed by the address of the
+   cif, so that ffi_cif itself keeps its layout and nothing has to be
+   allocated on the call path.  Slots are claimed with a compare and
+   swap and never released (except by ffi_stats_reset); once the table
+   is full, calls through new cifs are silently not counted.  */
+
+#define FFI_STATS_SLOTS 1024
+
+struct stats_slot
+{
+  ffi_cif *cif;
+  UINT64 calls;
+  UINT64 call_ticks;
+  UINT64 closure_calls;
+  UINT64 closure_ticks;
+};
+
+static struct stats_slot stats_table[FFI_STATS_SLOTS];
+
+int ffi_stats_enabled;
+
+UINT64
+ffi_stats_clock_generic (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (UINT64) ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static struct stats_slot *
+stats_lookup (ffi_cif *cif)
+{
+  unsigned i, h;
+
+  h = (unsigned) (((size_t) cif >> 4) * 2654435761u);
+  for (i = 0; i < FFI_STATS_SLOTS; i++)
+    {
+      struct stats_slot *s = &stats_table[(h + i) % FFI_STATS_SLOTS];
+      ffi_cif *cur = __atomic_load_n (&s->cif, __ATOMIC_ACQUIRE);
+
+      if (cur == cif)
+	return s;
+      if (cur == NULL)
+	{
+	  if (__atomic_compare_exchange_n (&s->cif, &cur, cif, 0,
+					   __ATOMIC_ACQ_REL,
+					   __ATOMIC_ACQUIRE)
+	      || cur == cif)
+	    return s;
+	}
+    }
+  return NULL;
+}
+
+void
+ffi_stats_record (ffi_cif *cif, int closure, UINT64 ticks)
+{
+  struct stats_slot *s = stats_lookup (cif);
+
+  if (s == NULL)
+    return;
+  if (closure)
+    {
+      __atomic_fetch_add (&s->closure_calls, 1, __ATOMIC_RELAXED);
+      __atomic_fetch_add (&s->closure_ticks, ticks, __ATOMIC_RELAXED);
+    }
+  else
+    {
+      __atomic_fetch_add (&s->calls, 1, __ATOMIC_RELAXED);
+      __atomic_fetch_add (&s->call_ticks, ticks, __ATOMIC_RELAXED);
+    }
+}
+
+int
+ffi_stats_enable (int enable)
+{
+  return __atomic_exchange_n (&ffi_stats_enabled, enable != 0,
+			      __ATOMIC_RELAXED);
+}
+
+void
+ffi_stats_reset (void)
+{
+  unsigned i;
+
+  for (i = 0; i < FFI_STATS_SLOTS; i++)
+    {
+      struct stats_slot *s = &stats_table[i];
+
+      __atomic_store_n (&s->calls, 0, __ATOMIC_RELAXED);
+      __atomic_store_n (&s->call_ticks, 0, __ATOMIC_RELAXED);
+      __atomic_store_n (&s->closure_calls, 0, __ATOMIC_RELAXED);
+      __atomic_store_n (&s->closure_ticks, 0, __ATOMIC_RELAXED);
+      __atomic_store_n (&s->cif, NULL, __ATOMIC_RELEASE);
+    }
+}
+
+static UINT64
+stats_key (const ffi_stats *st, ffi_stats_order order)
+{
+  if (order == FFI_STATS_BY_TICKS)
+    return st->call_ticks + st->closure_ticks;
+  return st->calls + st->closure_calls;
+}
+
+/* Copy the COUNT hottest cifs, hottest first, into STATS.  Returns
+   the number of entries filled in.  A simple insertion into the
+   bounded output array is enough; COUNT is expected to be small.  */
+
+size_t
+ffi_stats_top (ffi_stats *stats, size_t count, ffi_stats_order order)
+{
+  size_t n = 0;
+  unsigned i;
+
+  if (stats == NULL || count == 0)
+    return 0;
+
+  for (i = 0; i < FFI_STATS_SLOTS; i++)
+    {
+      struct stats_slot *s = &stats_table[i];
+      ffi_stats cur;
+      size_t j;
+
+      cur.cif = __atomic_load_n (&s->cif, __ATOMIC_ACQUIRE);
+      if (cur.cif == NULL)
+	continue;
+      cur.calls = __atomic_load_n (&s->calls, __ATOMIC_RELAXED);
+      cur.call_ticks = __atomic_load_n (&s->call_ticks, __ATOMIC_RELAXED);
+      cur.closure_calls = __atomic_load_n (&s->closure_calls,
+					   __ATOMIC_RELAXED);
+      cur.closure_ticks = __atomic_load_n (&s->closure_ticks,
+					   __ATOMIC_RELAXED);
+      if (cur.calls + cur.closure_calls == 0)
+	continue;
+
+      j = n < count ? n++ : count;
+      if (j == count)
+	{
+	  if (stats_key (&stats[count - 1], order) >= stats_key (&cur, order))
+	    continue;
+	  j = count - 1;
+	}
+      while (j > 0
+	     && stats_key (&stats[j - 1], order) < stats_key (&cur, order))
+	{
+	  stats[j] = stats[j - 1];
+	  j--;
+	}
+      stats[j] = cur;
+    }
+
+  return n;
+}
+
+#else /* !FFI_STATS */
+
+int
+ffi_stats_enable (int enable)
+{
+  (void) enable;
+  return -1;
+}
+
+void
+ffi_stats_reset (void)
+{
+}
+
+size_t
+ffi_stats_top (ffi_stats *stats, size_t count, ffi_stats_order order)
+{
+  (void) stats;
+  (void) count;
+  (void) order;
+  return 0;
+}
+
+#endif /* FFI_STATS */
@@ -0,0 +1,199 @@
+/* -----------------------------------------------------------------------
+   thunk_table.c - Many closures sharing one cif and function.
+
+   Permission is hereby granted, free of charge, to any person obtaining
+   a copy of this software and associated documentation files (the
+   ``Software''), to deal in the Software without restriction, including
+   without limitation the rights to use, copy, modify, merge, publish,
+   distribute, sublicense, and/or sell copies of the Software, and to
+   permit persons to whom the Software is furnished to do so, subject to
+   the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED ``AS IS'', WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+   NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+   ----------------------------------------------------------------------- */
+
+
+#include <ffi.h>
+#include <ffi_common.h>
+#include <stdlib.h>
+
+#if FFI_CLOSURES
+
+/* A thunk table holds COUNT entry points that share a cif and a
+   function and differ only in their user data, which lives in an
+   ordinary array.  Targets that can lay out compact entries do so in
+   ffi_prep_thunk_table_machdep.  Otherwise the entries are closures in
+   one executable block, or allocated one by one where closures come
+   from a trampoline table, each passing a slot that points back to
+   the table, so the index is recovered from the slot's position.  */
+
+void FFI_HIDDEN
+ffi_thunk_dispatch (ffi_cif *cif, void *rvalue, void **avalue, void *slot)
+{
+  ffi_thunk_table *table = *(ffi_thunk_table **) slot;
+  size_t i = (size_t) ((char *) slot - table->slots) / table->slot_size;
+
+  table->fun (cif, rvalue, avalue, table->user_data[i]);
+}
+
+#if !FFI_EXEC_TRAMPOLINE_TABLE
+static ffi_status
+prep_thunk_table_closures (ffi_thunk_table *table)
+{
+  ffi_thunk_table **slots = (ffi_thunk_table **) (table->user_data
+						  + table->count);
+  ffi_closure *closures;
+  void *code;
+  size_t i;
+
+  if (table->count > (size_t) -1 / sizeof (ffi_closure))
+    return FFI_BAD_TYPEDEF;
+  closures = ffi_closure_alloc (table->count * sizeof (ffi_closure), &code);
+  if (closures == NULL)
+    return FFI_BAD_TYPEDEF;
+
+  for (i = 0; i < table->count; i++)
+    {
+      ffi_status status;
+
+      slots[i] = table;
+      status = ffi_prep_closure_loc (&closures[i], table->cif,
+				     ffi_thunk_dispatch, &slots[i],
+				     (char *) code + i * sizeof (ffi_closure));
+      if (status != FFI_OK)
+	{
+	  ffi_closure_free (closures);
+	  return status;
+	}
+    }
+
+  table->mem = closures;
+  table->code = code;
+  table->stride = sizeof (ffi_closure);
+  table->slots = (char *) slots;
+  table->slot_size = sizeof (*slots);
+  return FFI_OK;
+}
+#else
+static void
+free_thunk_table_entries (ffi_thunk_table *table)
+{
+  size_t i;
+
+  for (i = 0; i < table->count && table->entries[i] != NULL; i++)
+    ffi_closure_free (table->entries[i]);
+  free (table->entries);
+}
+
+static ffi_status
+prep_thunk_table_closures (ffi_thunk_table *table)
+{
+  ffi_thunk_table **slots = (ffi_thunk_table **) (table->user_data
+						  + table->count);
+  size_t i;
+
+  if (table->count > (size_t) -1 / (2 * sizeof (void *)))
+    return FFI_BAD_TYPEDEF;
+  table->entries = calloc (2 * table->count, sizeof (void *));
+  if (table->entries == NULL)
+    return FFI_BAD_TYPEDEF;
+
+  for (i = 0; i < table->count; i++)
+    {
+      void **code = &table->entries[table->count + i];
+      ffi_closure *closure = ffi_closure_alloc (sizeof (ffi_closure), code);
+      ffi_status status = FFI_BAD_TYPEDEF;
+
+      if (closure != NULL)
+	{
+	  table->entries[i] = closure;
+	  slots[i] = table;
+	  status = ffi_prep_closure_loc (closure, table->cif,
+					 ffi_thunk_dispatch, &slots[i], *code);
+	}
+      if (status != FFI_OK)
+	{
+	  free_thunk_table_entries (table);
+	  return status;
+	}
+    }
+
+  table->slots = (char *) slots;
+  table->slot_size = sizeof (*slots);
+  return FFI_OK;
+}
+#endif
+
+ffi_thunk_table *
+ffi_thunk_table_alloc (ffi_cif *cif, void (*fun)(ffi_cif*,void*,void**,void*),
+		       size_t count)
+{
+  ffi_thunk_table *table;
+  ffi_status status = FFI_BAD_ABI;
+
+  if (cif == NULL || fun == NULL || count == 0
+      || count > ((size_t) -1 - sizeof (*table)) / (2 * sizeof (void *)))
+    return NULL;
+
+  /* The user data is followed by the slots of the fallback.  */
+  table = calloc (1, sizeof (*table) + count * 2 * sizeof (void *));
+  if (table == NULL)
+    return NULL;
+  table->cif = cif;
+  table->fun = fun;
+  table->count = count;
+  table->user_data = (void **) (table + 1);
+
+#ifdef FFI_TARGET_HAS_THUNK_TABLE
+  status = ffi_prep_thunk_table_machdep (table);
+#endif
+  if (status == FFI_BAD_ABI)
+    status = prep_thunk_table_closures (table);
+  if (status != FFI_OK)
+    {
+      free (table);
+      return NULL;
+    }
+  return table;
+}
+
+void
+ffi_thunk_table_free (ffi_thunk_table *table)
+{
+  if (table == NULL)
+    return;
+#if FFI_EXEC_TRAMPOLINE_TABLE
+  free_thunk_table_entries (table);
+#else
+  ffi_closure_free (table->mem);
+#endif
+  free (table);
+}
+
+void *
+ffi_thunk_table_entry (ffi_thunk_table *table, size_t index)
+{
+  if (index >= table->count)
+    return NULL;
+  if (table->entries != NULL)
+    return table->entries[table->count + index];
+  return table->code + index * table->stride;
+}
+
+void **
+ffi_thunk_table_user_data (ffi_thunk_table *table)
+{
+  return table->user_data;
+}
+
+#endif /* FFI_CLOSURES */
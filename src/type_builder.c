@@ -0,0 +1,177 @@
+/* -----------------------------------------------------------------------
+   type_builder.c - Build ffi_type graphs in an arena.
+
+   Permission is hereby granted, free of charge, to any person obtaining
+   a copy of this software and associated documentation files (the
+   ``Software''), to deal in the Software without restriction, including
+   without limitation the rights to use, copy, modify, merge, publish,
+   distribute, sublicense, and/or sell copies of the Software, and to
+   permit persons to whom the Software is furnished to do so, subject to
+   the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED ``AS IS'', WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+   NONINFRINGEMENT.  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+   HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+   WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+   ----------------------------------------------------------------------- */
+
+#include <ffi.h>
+#include <ffi_common.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Types and their element lists are carved out of large blocks, one
+   after the other, so that a graph built in one go sits in contiguous
+   memory.  A block is only added when the current one is full; the
+   size hint given to ffi_type_builder_new lets a caller that knows
+   roughly how big its graph is get it in a single block.  */
+
+#define BUILDER_MIN_BLOCK 4096
+#define BUILDER_ALIGN 8
+
+struct builder_block
+{
+  struct builder_block *next;
+  size_t size;
+  size_t used;
+};
+
+struct ffi_type_builder
+{
+  ffi_abi abi;
+  struct builder_block *blocks;
+};
+
+static void *
+builder_alloc (ffi_type_builder *b, size_t size)
+{
+  struct builder_block *blk = b->blocks;
+  size_t hdr = FFI_ALIGN (sizeof (struct builder_block), BUILDER_ALIGN);
+  void *p;
+
+  size = FFI_ALIGN (size, BUILDER_ALIGN);
+  if (blk == NULL || blk->size - blk->used < size)
+    {
+      size_t bsize = size > BUILDER_MIN_BLOCK ? size : BUILDER_MIN_BLOCK;
+
+      if (blk != NULL && bsize < blk->size)
+	bsize = blk->size;
+      blk = malloc (hdr + bsize);
+      if (blk == NULL)
+	return NULL;
+      blk->next = b->blocks;
+      blk->size = bsize;
+      blk->used = 0;
+      b->blocks = blk;
+    }
+
+  p = (char *) blk + hdr + blk->used;
+  blk->used += size;
+  return p;
+}
+
+ffi_type_builder *
+ffi_type_builder_new (ffi_abi abi, size_t size_hint)
+{
+  ffi_type_builder *b;
+
+  if (! (abi > FFI_FIRST_ABI && abi < FFI_LAST_ABI))
+    return NULL;
+
+  b = malloc (sizeof (*b));
+  if (b == NULL)
+    return NULL;
+  b->abi = abi;
+  b->blocks = NULL;
+
+  /* Reserve the first block up front, so that it has the size the
+     caller asked for.  */
+  if (size_hint > BUILDER_MIN_BLOCK)
+    {
+      if (builder_alloc (b, size_hint) == NULL)
+	{
+	  free (b);
+	  return NULL;
+	}
+      b->blocks->used = 0;
+    }
+  return b;
+}
+
+ffi_type *
+ffi_type_builder_struct (ffi_type_builder *b, size_t nelements,
+			 ffi_type **elements, size_t *offsets)
+{
+  ffi_type *t;
+  ffi_type **elts;
+
+  if (b == NULL || nelements == 0 || elements == NULL)
+    return NULL;
+
+  t = builder_alloc (b, sizeof (ffi_type)
+			+ (nelements + 1) * sizeof (ffi_type *));
+  if (t == NULL)
+    return NULL;
+  elts = (ffi_type **) (t + 1);
+  memcpy (elts, elements, nelements * sizeof (ffi_type *));
+  elts[nelements] = NULL;
+
+  t->size = 0;
+  t->alignment = 0;
+  t->type = FFI_TYPE_STRUCT;
+  t->elements = elts;
+
+  /* Lay the structure out now, rather than on first use.  */
+  if (ffi_get_struct_offsets (b->abi, t, offsets) != FFI_OK)
+    return NULL;
+  return t;
+}
+
+ffi_type *
+ffi_type_builder_array (ffi_type_builder *b, ffi_type *element,
+			size_t count)
+{
+  ffi_type *t;
+  ffi_type **elts;
+
+  if (b == NULL || element == NULL)
+    return NULL;
+
+  t = builder_alloc (b, sizeof (ffi_type) + 2 * sizeof (ffi_type *));
+  if (t == NULL)
+    return NULL;
+  elts = (ffi_type **) (t + 1);
+  elts[0] = element;
+  elts[1] = NULL;
+
+  t->size = 0;
+  t->alignment = 0;
+  t->type = FFI_TYPE_ARRAY;
+  t->elements = elts;
+
+  if (ffi_prep_array_type (t, count) != FFI_OK)
+    return NULL;
+  return t;
+}
+
+void
+ffi_type_builder_free (ffi_type_builder *b)
+{
+  struct builder_block *blk, *next;
+
+  if (b == NULL)
+    return;
+  for (blk = b->blocks; blk; blk = next)
+    {
+      next = blk->next;
+      free (blk);
+    }
+  free (b);
+}
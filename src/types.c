@@ -106,3 +106,19 @@ FFI_COMPLEX_TYPEDEF(double, double, const);
 FFI_COMPLEX_TYPEDEF(longdouble, long double, FFI_LDBL_CONST);
 #endif
 #endif
+
+#ifdef FFI_TARGET_HAS_INT128_TYPE
+FFI_TYPEDEF(uint128, unsigned __int128, FFI_TYPE_UINT128, const);
+FFI_TYPEDEF(sint128, __int128, FFI_TYPE_SINT128, const);
+#endif
+
+#ifdef FFI_TARGET_HAS_FLOAT16_TYPE
+/* Spelled out rather than using FFI_TYPEDEF, so that building libffi
+   does not need a compiler that knows _Float16 and __bf16.  */
+FFI_EXTERN const ffi_type ffi_type_float16 = {
+  2, 2, FFI_TYPE_FLOAT16, NULL
+};
+FFI_EXTERN const ffi_type ffi_type_bfloat16 = {
+  2, 2, FFI_TYPE_BFLOAT16, NULL
+};
+#endif
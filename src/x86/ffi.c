@@ -51,12 +51,89 @@
 # define __declspec(x)  __attribute__((x))
 #endif
 
+struct abi_params
+{
+  int dir;		/* parameter growth direction */
+  int static_chain;	/* the static chain register used by gcc */
+  int nregs;		/* number of register parameters */
+  int regs[3];
+};
+
+static const struct abi_params abi_params[FFI_LAST_ABI] = {
+  [FFI_SYSV] = { 1, R_ECX, 0 },
+  [FFI_THISCALL] = { 1, R_EAX, 1, { R_ECX } },
+  [FFI_FASTCALL] = { 1, R_EAX, 2, { R_ECX, R_EDX } },
+  [FFI_STDCALL] = { 1, R_ECX, 0 },
+  [FFI_PASCAL] = { -1, R_ECX, 0 },
+  /* ??? No defined static chain; gcc does not support REGISTER.  */
+  [FFI_REGISTER] = { -1, R_ECX, 3, { R_EAX, R_EDX, R_ECX } },
+  [FFI_MS_CDECL] = { 1, R_ECX, 0 }
+};
+
+/* Choose how an argument of type TY is passed, when NREG of the
+   ABI's argument registers are already taken.  */
+
+static unsigned
+x86_arg_kind (const struct abi_params *pabi, const ffi_type *ty, int nreg)
+{
+  unsigned kind;
+
+  if (ty->type == FFI_TYPE_STRUCT || ty->size > FFI_SIZEOF_ARG)
+    {
+      /* Alignment rules for arguments are quite complex.  Vectors and
+	 structures with 16 byte alignment get it.  Note that long double
+	 on Darwin does have 16 byte alignment, and does not get this
+	 alignment if passed directly; a structure with a long double
+	 inside, however, would get 16 byte alignment.  Since libffi does
+	 not support vectors, we need non concern ourselves with other
+	 cases.  The reverse argument ABIs are probably too old to have
+	 cared about alignment.  */
+      if (ty->type == FFI_TYPE_STRUCT && ty->alignment >= 16
+	  && pabi->dir > 0)
+	return X86_ARG_MEM16;
+      return X86_ARG_MEM;
+    }
+
+  switch (ty->type)
+    {
+    case FFI_TYPE_SINT8:
+      kind = X86_ARG_SINT8;
+      break;
+    case FFI_TYPE_UINT8:
+      kind = X86_ARG_UINT8;
+      break;
+    case FFI_TYPE_SINT16:
+      kind = X86_ARG_SINT16;
+      break;
+    case FFI_TYPE_UINT16:
+      kind = X86_ARG_UINT16;
+      break;
+    case FFI_TYPE_INT:
+    case FFI_TYPE_SINT32:
+    case FFI_TYPE_UINT32:
+    case FFI_TYPE_POINTER:
+      kind = X86_ARG_INT32;
+      break;
+    case FFI_TYPE_FLOAT:
+      /* Never passed in a register.  */
+      return X86_ARG_INT32;
+    default:
+      /* Small complex types are passed in memory.  */
+      return X86_ARG_MEM;
+    }
+
+  if (nreg < pabi->nregs)
+    kind |= X86_ARG_REG;
+  return kind;
+}
+
 /* Perform machine dependent cif processing.  */
 ffi_status FFI_HIDDEN
 ffi_prep_cif_machdep(ffi_cif *cif)
 {
   size_t bytes = 0;
-  int i, n, flags, cabi = cif->abi;
+  int i, n, flags, nreg, cabi = cif->abi;
+  unsigned kind, plan;
 
   switch (cabi)
     {
@@ -168,7 +245,10 @@ ffi_prep_cif_machdep(ffi_cif *cif)
     default:
       return FFI_BAD_TYPEDEF;
     }
-  cif->flags = flags;
+
+  /* A structure return pointer passed in a register takes the first.  */
+  nreg = (flags == X86_RET_STRUCTARG && abi_params[cabi].nregs > 0);
+  plan = 0;
 
   for (i = 0, n = cif->nargs; i < n; i++)
     {
@@ -176,12 +256,21 @@ ffi_prep_cif_machdep(ffi_cif *cif)
 
       bytes = FFI_ALIGN (bytes, t->alignment);
       bytes += FFI_ALIGN (t->size, FFI_SIZEOF_ARG);
+
+      if (i < X86_PLAN_ARGS)
+	{
+	  kind = x86_arg_kind (&abi_params[cabi], t, nreg);
+	  nreg += (kind & X86_ARG_REG) != 0;
+	  plan |= kind << (X86_ARG_BITS * i);
+	}
     }
   cif->bytes = FFI_ALIGN (bytes, 16);
+  cif->flags = flags | (plan << X86_PLAN_SHIFT);
 
   return FFI_OK;
 }
 
+#if !FFI_NO_RAW_API
 static ffi_arg
 extend_basic_type(void *arg, int type)
 {
@@ -206,6 +295,7 @@ extend_basic_type(void *arg, int type)
       abort();
     }
 }
+#endif
 
 struct call_frame
 {
@@ -217,25 +307,6 @@ struct call_frame
   unsigned regs[3];	/* 20-28 */
 };
 
-struct abi_params
-{
-  int dir;		/* parameter growth direction */
-  int static_chain;	/* the static chain register used by gcc */
-  int nregs;		/* number of register parameters */
-  int regs[3];
-};
-
-static const struct abi_params abi_params[FFI_LAST_ABI] = {
-  [FFI_SYSV] = { 1, R_ECX, 0 },
-  [FFI_THISCALL] = { 1, R_EAX, 1, { R_ECX } },
-  [FFI_FASTCALL] = { 1, R_EAX, 2, { R_ECX, R_EDX } },
-  [FFI_STDCALL] = { 1, R_ECX, 0 },
-  [FFI_PASCAL] = { -1, R_ECX, 0 },
-  /* ??? No defined static chain; gcc does not support REGISTER.  */
-  [FFI_REGISTER] = { -1, R_ECX, 3, { R_EAX, R_EDX, R_ECX } },
-  [FFI_MS_CDECL] = { 1, R_ECX, 0 }
-};
-
 #ifdef HAVE_FASTCALL
   #ifdef _MSC_VER
     #define FFI_DECLARE_FASTCALL __fastcall
@@ -252,14 +323,17 @@ static void
 ffi_call_int (ffi_cif *cif, void (*fn)(void), void *rvalue,
 	      void **avalue, void *closure)
 {
-  size_t rsize, bytes;
+  size_t rsize, bytes, back, fwd;
   struct call_frame *frame;
   char *stack, *argp;
   ffi_type **arg_types;
   int flags, cabi, i, n, dir, narg_reg;
+  unsigned plan, kind;
   const struct abi_params *pabi;
+  FFI_STATS_START (ticks);
 
-  flags = cif->flags;
+  flags = cif->flags & X86_RET_TYPE_MASK;
+  plan = (unsigned) cif->flags >> X86_PLAN_SHIFT;
   cabi = cif->abi;
   pabi = &abi_params[cabi];
   dir = pabi->dir;
@@ -315,64 +389,69 @@ ffi_call_int (ffi_cif *cif, void (*fn)(void), void *rvalue,
       break;
     }
 
+  /* Arguments are stored upwards, or downwards for the reverse
+     argument ABIs; BACK and FWD select the direction without a
+     branch.  */
+  back = dir < 0;
+  fwd = !back;
+
   arg_types = cif->arg_types;
   for (i = 0, n = cif->nargs; i < n; i++)
     {
       ffi_type *ty = arg_types[i];
       void *valp = avalue[i];
-      size_t z = ty->size;
-      int t = ty->type;
+      ffi_arg val;
+      size_t za;
 
-      if (z <= FFI_SIZEOF_ARG && t != FFI_TYPE_STRUCT)
-        {
-	  ffi_arg val = extend_basic_type (valp, t);
+      if (i < X86_PLAN_ARGS)
+	{
+	  kind = plan & X86_ARG_MASK;
+	  plan >>= X86_ARG_BITS;
+	}
+      else
+	kind = x86_arg_kind (pabi, ty, narg_reg);
 
-	  if (t != FFI_TYPE_FLOAT && narg_reg < pabi->nregs)
-	    frame->regs[pabi->regs[narg_reg++]] = val;
-	  else if (dir < 0)
-	    {
-	      argp -= 4;
-	      *(ffi_arg *)argp = val;
-	    }
-	  else
-	    {
-	      *(ffi_arg *)argp = val;
-	      argp += 4;
-	    }
+      switch (kind & ~X86_ARG_REG)
+	{
+	case X86_ARG_SINT8:
+	  val = *(SINT8 *)valp;
+	  break;
+	case X86_ARG_UINT8:
+	  val = *(UINT8 *)valp;
+	  break;
+	case X86_ARG_SINT16:
+	  val = *(SINT16 *)valp;
+	  break;
+	case X86_ARG_UINT16:
+	  val = *(UINT16 *)valp;
+	  break;
+	case X86_ARG_MEM16:
+	  argp = (char *)FFI_ALIGN (argp, 16);
+	  /* fallthru */
+	case X86_ARG_MEM:
+	  za = FFI_ALIGN (ty->size, FFI_SIZEOF_ARG);
+	  argp -= back * za;
+	  memcpy (argp, valp, ty->size);
+	  argp += fwd * za;
+	  continue;
+	default:
+	  val = *(UINT32 *)valp;
+	  break;
 	}
+
+      if (kind & X86_ARG_REG)
+	frame->regs[pabi->regs[narg_reg++]] = val;
       else
 	{
-	  size_t za = FFI_ALIGN (z, FFI_SIZEOF_ARG);
-	  size_t align = FFI_SIZEOF_ARG;
-
-	  /* Alignment rules for arguments are quite complex.  Vectors and
-	     structures with 16 byte alignment get it.  Note that long double
-	     on Darwin does have 16 byte alignment, and does not get this
-	     alignment if passed directly; a structure with a long double
-	     inside, however, would get 16 byte alignment.  Since libffi does
-	     not support vectors, we need non concern ourselves with other
-	     cases.  */
-	  if (t == FFI_TYPE_STRUCT && ty->alignment >= 16)
-	    align = 16;
-	    
-	  if (dir < 0)
-	    {
-	      /* ??? These reverse argument ABIs are probably too old
-		 to have cared about alignment.  Someone should check.  */
-	      argp -= za;
-	      memcpy (argp, valp, z);
-	    }
-	  else
-	    {
-	      argp = (char *)FFI_ALIGN (argp, align);
-	      memcpy (argp, valp, z);
-	      argp += za;
-	    }
+	  argp -= back * 4;
+	  *(ffi_arg *)argp = val;
+	  argp += fwd * 4;
 	}
     }
   FFI_ASSERT (dir > 0 || argp == stack);
 
   ffi_call_i386 (frame, stack);
+  FFI_STATS_STOP (ticks, cif, 0);
 }
 
 void
@@ -408,14 +487,18 @@ ffi_closure_inner (struct closure_frame *frame, char *stack)
 {
   ffi_cif *cif = frame->cif;
   int cabi, i, n, flags, dir, narg_reg;
+  unsigned plan, kind;
   const struct abi_params *pabi;
   ffi_type **arg_types;
   char *argp;
   void *rvalue;
   void **avalue;
+  size_t back, fwd;
+  FFI_STATS_START (ticks);
 
   cabi = cif->abi;
-  flags = cif->flags;
+  flags = cif->flags & X86_RET_TYPE_MASK;
+  plan = (unsigned) cif->flags >> X86_PLAN_SHIFT;
   narg_reg = 0;
   rvalue = frame->rettemp;
   pabi = &abi_params[cabi];
@@ -443,57 +526,46 @@ ffi_closure_inner (struct closure_frame *frame, char *stack)
   n = cif->nargs;
   avalue = alloca(sizeof(void *) * n);
 
+  /* See the comment in ffi_call_int.  */
+  back = dir < 0;
+  fwd = !back;
+
   arg_types = cif->arg_types;
   for (i = 0; i < n; ++i)
     {
       ffi_type *ty = arg_types[i];
-      size_t z = ty->size;
-      int t = ty->type;
       void *valp;
+      size_t za;
 
-      if (z <= FFI_SIZEOF_ARG && t != FFI_TYPE_STRUCT)
+      if (i < X86_PLAN_ARGS)
 	{
-	  if (t != FFI_TYPE_FLOAT && narg_reg < pabi->nregs)
-	    valp = &frame->regs[pabi->regs[narg_reg++]];
-	  else if (dir < 0)
-	    {
-	      argp -= 4;
-	      valp = argp;
-	    }
-	  else
-	    {
-	      valp = argp;
-	      argp += 4;
-	    }
+	  kind = plan & X86_ARG_MASK;
+	  plan >>= X86_ARG_BITS;
 	}
       else
-	{
-	  size_t za = FFI_ALIGN (z, FFI_SIZEOF_ARG);
-	  size_t align = FFI_SIZEOF_ARG;
-
-	  /* See the comment in ffi_call_int.  */
-	  if (t == FFI_TYPE_STRUCT && ty->alignment >= 16)
-	    align = 16;
+	kind = x86_arg_kind (pabi, ty, narg_reg);
 
-	  if (dir < 0)
-	    {
-	      /* ??? These reverse argument ABIs are probably too old
-		 to have cared about alignment.  Someone should check.  */
-	      argp -= za;
-	      valp = argp;
-	    }
-	  else
+      if (kind & X86_ARG_REG)
+	valp = &frame->regs[pabi->regs[narg_reg++]];
+      else
+	{
+	  za = FFI_SIZEOF_ARG;
+	  if (kind >= X86_ARG_MEM)
 	    {
-	      argp = (char *)FFI_ALIGN (argp, align);
-	      valp = argp;
-	      argp += za;
+	      if (kind == X86_ARG_MEM16)
+		argp = (char *)FFI_ALIGN (argp, 16);
+	      za = FFI_ALIGN (ty->size, FFI_SIZEOF_ARG);
 	    }
+	  argp -= back * za;
+	  valp = argp;
+	  argp += fwd * za;
 	}
 
       avalue[i] = valp;
     }
 
   frame->fun (cif, rvalue, avalue, frame->user_data);
+  FFI_STATS_STOP (ticks, cif, 1);
 
   if (cabi == FFI_STDCALL)
     return flags + (cif->bytes << X86_RET_POP_SHIFT);
@@ -649,7 +721,7 @@ ffi_raw_call(ffi_cif *cif, void (*fn)(void), void *rvalue, ffi_raw *avalue)
   int flags, cabi, i, n, narg_reg;
   const struct abi_params *pabi;
 
-  flags = cif->flags;
+  flags = cif->flags & X86_RET_TYPE_MASK;
   cabi = cif->abi;
   pabi = &abi_params[cabi];
 
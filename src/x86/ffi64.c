@@ -171,6 +171,8 @@ classify_argument (ffi_type *type, enum x86_64_reg_class classes[],
     case FFI_TYPE_UINT64:
     case FFI_TYPE_SINT64:
     case FFI_TYPE_POINTER:
+    case FFI_TYPE_UINT128:
+    case FFI_TYPE_SINT128:
     do_integer:
       {
 	size_t size = byte_offset + type->size;
@@ -208,6 +210,10 @@ classify_argument (ffi_type *type, enum x86_64_reg_class classes[],
     case FFI_TYPE_DOUBLE:
       classes[0] = X86_64_SSEDF_CLASS;
       return 1;
+    case FFI_TYPE_FLOAT16:
+    case FFI_TYPE_BFLOAT16:
+      classes[0] = X86_64_SSE_CLASS;
+      return 1;
 #if FFI_TYPE_LONGDOUBLE != FFI_TYPE_DOUBLE
     case FFI_TYPE_LONGDOUBLE:
       classes[0] = X86_64_X87_CLASS;
@@ -215,9 +221,11 @@ classify_argument (ffi_type *type, enum x86_64_reg_class classes[],
       return 2;
 #endif
     case FFI_TYPE_STRUCT:
+    case FFI_TYPE_ARRAY:
       {
 	const size_t UNITS_PER_WORD = 8;
-	size_t words = (type->size + UNITS_PER_WORD - 1) / UNITS_PER_WORD;
+	size_t words = (byte_offset + type->size + UNITS_PER_WORD - 1)
+		       / UNITS_PER_WORD;
 	ffi_type **ptr;
 	unsigned int i;
 	enum x86_64_reg_class subclasses[MAX_CLASSES];
@@ -238,24 +246,33 @@ classify_argument (ffi_type *type, enum x86_64_reg_class classes[],
 	    return 1;
 	  }
 
-	/* Merge the fields of structure.  */
+	/* Merge the fields of structure.  An array is merged as if it
+	   were a structure repeating its element; the size check above
+	   bounds the number of elements visited.  */
 	for (ptr = type->elements; *ptr != NULL; ptr++)
 	  {
-	    size_t num;
-
-	    byte_offset = FFI_ALIGN (byte_offset, (*ptr)->alignment);
+	    size_t j, count = 1;
 
-	    num = classify_argument (*ptr, subclasses, byte_offset % 8);
-	    if (num == 0)
-	      return 0;
-	    for (i = 0; i < num; i++)
+	    if (type->type == FFI_TYPE_ARRAY)
+	      count = type->size / (*ptr)->size;
+	    for (j = 0; j < count; j++)
 	      {
-		size_t pos = byte_offset / 8;
-		classes[i + pos] =
-		  merge_classes (subclasses[i], classes[i + pos]);
-	      }
+		size_t num;
+
+		byte_offset = FFI_ALIGN (byte_offset, (*ptr)->alignment);
+
+		num = classify_argument (*ptr, subclasses, byte_offset % 8);
+		if (num == 0)
+		  return 0;
+		for (i = 0; i < num; i++)
+		  {
+		    size_t pos = byte_offset / 8;
+		    classes[i + pos] =
+		      merge_classes (subclasses[i], classes[i + pos]);
+		  }
 
-	    byte_offset += (*ptr)->size;
+		byte_offset += (*ptr)->size;
+	      }
 	  }
 
 	if (words > 2)
@@ -303,6 +320,20 @@ classify_argument (ffi_type *type, enum x86_64_reg_class classes[],
 	  }
 	return words;
       }
+    case FFI_TYPE_VECTOR:
+      {
+	size_t i, words = type->size / 8;
+
+	/* A vector fills a single xmm or ymm register: the first
+	   eightbyte is SSE and the rest are SSEUP.  Widths that have
+	   no register are rejected by ffi_prep_cif_machdep.  */
+	if (words == 0 || words > MAX_CLASSES)
+	  return 0;
+	classes[0] = X86_64_SSE_CLASS;
+	for (i = 1; i < words; i++)
+	  classes[i] = X86_64_SSEUP_CLASS;
+	return words;
+      }
     case FFI_TYPE_COMPLEX:
       {
 	ffi_type *inner = type->elements[0];
@@ -387,6 +418,97 @@ examine_argument (ffi_type *type, enum x86_64_reg_class classes[MAX_CLASSES],
   return n;
 }
 
+/* Return true unless TYPE is a vector that does not fit exactly in an
+   MMX-sized, xmm or ymm register.  */
+
+static _Bool
+vector_width_ok (const ffi_type *type)
+{
+  return (type->type != FFI_TYPE_VECTOR
+	  || type->size == 8 || type->size == 16 || type->size == 32);
+}
+
+/* Go over the arguments of CIF from FIRST on and determine the way
+   they should be passed.  If it's in a register and there is space for
+   it, let that be so.  If not, add its size to the stack byte count.
+   STATE holds the general and SSE registers used so far and the stack
+   byte count, and is updated.  */
+
+static ffi_status
+unix64_prep_args (ffi_cif *cif, unsigned first, unsigned state[3],
+		  unsigned *pflags)
+{
+  enum x86_64_reg_class classes[MAX_CLASSES];
+  int gprcount = (int) state[0], ssecount = (int) state[1];
+  size_t bytes = state[2], n;
+  unsigned i, avn;
+  int ngpr, nsse;
+
+  for (i = first, avn = cif->nargs; i < avn; i++)
+    {
+      if (!vector_width_ok (cif->arg_types[i]))
+	return FFI_BAD_TYPEDEF;
+
+      n = examine_argument (cif->arg_types[i], classes, 0, &ngpr, &nsse);
+      if (n == 0
+	  || gprcount + ngpr > MAX_GPR_REGS
+	  || ssecount + nsse > MAX_SSE_REGS)
+	{
+	  long align = cif->arg_types[i]->alignment;
+
+	  if (align < 8)
+	    align = 8;
+
+	  bytes = FFI_ALIGN (bytes, align);
+	  bytes += cif->arg_types[i]->size;
+	}
+      else
+	{
+	  gprcount += ngpr;
+	  ssecount += nsse;
+	  if (n > 2 && classes[2] == X86_64_SSEUP_CLASS)
+	    *pflags |= UNIX64_FLAG_YMM_ARGS;
+	}
+    }
+
+  state[0] = gprcount;
+  state[1] = ssecount;
+  state[2] = (unsigned) bytes;
+  return FFI_OK;
+}
+
+/* Return true if every argument of CIF is an integer, pointer, float
+   or double.  When none of them went to the stack either, each one has
+   a register of its own and calls and closures can skip classifying
+   them.  */
+
+static _Bool
+unix64_simple_args (ffi_cif *cif)
+{
+  unsigned i;
+
+  for (i = 0; i < cif->nargs; i++)
+    switch (cif->arg_types[i]->type)
+      {
+      case FFI_TYPE_INT:
+      case FFI_TYPE_UINT8:
+      case FFI_TYPE_SINT8:
+      case FFI_TYPE_UINT16:
+      case FFI_TYPE_SINT16:
+      case FFI_TYPE_UINT32:
+      case FFI_TYPE_SINT32:
+      case FFI_TYPE_UINT64:
+      case FFI_TYPE_SINT64:
+      case FFI_TYPE_POINTER:
+      case FFI_TYPE_FLOAT:
+      case FFI_TYPE_DOUBLE:
+	break;
+      default:
+	return 0;
+      }
+  return 1;
+}
+
 /* Perform machine dependent cif processing.  */
 
 #ifndef __ILP32__
@@ -397,11 +519,12 @@ ffi_prep_cif_machdep_efi64(ffi_cif *cif);
 ffi_status
 ffi_prep_cif_machdep (ffi_cif *cif)
 {
-  int gprcount, ssecount, i, avn, ngpr, nsse;
-  unsigned flags;
+  int gprcount, ngpr, nsse;
+  unsigned flags, state[3];
   enum x86_64_reg_class classes[MAX_CLASSES];
-  size_t bytes, n, rtype_size;
+  size_t n, rtype_size;
   ffi_type *rtype;
+  ffi_status status;
 
 #ifndef __ILP32__
   if (cif->abi == FFI_EFI64)
@@ -410,7 +533,7 @@ ffi_prep_cif_machdep (ffi_cif *cif)
   if (cif->abi != FFI_UNIX64)
     return FFI_BAD_ABI;
 
-  gprcount = ssecount = 0;
+  gprcount = 0;
 
   rtype = cif->rtype;
   rtype_size = rtype->size;
@@ -451,9 +574,21 @@ ffi_prep_cif_machdep (ffi_cif *cif)
     case FFI_TYPE_DOUBLE:
       flags = UNIX64_RET_XMM64;
       break;
+    case FFI_TYPE_FLOAT16:
+    case FFI_TYPE_BFLOAT16:
+      flags = UNIX64_RET_XMM16;
+      break;
     case FFI_TYPE_LONGDOUBLE:
       flags = UNIX64_RET_X87;
       break;
+    case FFI_TYPE_UINT128:
+    case FFI_TYPE_SINT128:
+      flags = UNIX64_RET_ST_RAX_RDX | (16 << UNIX64_SIZE_SHIFT);
+      break;
+    case FFI_TYPE_VECTOR:
+      if (!vector_width_ok (rtype))
+	return FFI_BAD_TYPEDEF;
+      /* FALLTHRU */
     case FFI_TYPE_STRUCT:
       n = examine_argument (cif->rtype, classes, 1, &ngpr, &nsse);
       if (n == 0)
@@ -472,6 +607,8 @@ ffi_prep_cif_machdep (ffi_cif *cif)
 	    flags = UNIX64_RET_XMM32;
 	  else if (rtype_size == 8)
 	    flags = sse0 ? UNIX64_RET_XMM64 : UNIX64_RET_INT64;
+	  else if (n >= 2 && classes[1] == X86_64_SSEUP_CLASS)
+	    flags = n == 2 ? UNIX64_RET_XMM128 : UNIX64_RET_YMM256;
 	  else
 	    {
 	      _Bool sse1 = n == 2 && SSE_CLASS_P (classes[1]);
@@ -520,35 +657,64 @@ ffi_prep_cif_machdep (ffi_cif *cif)
       return FFI_BAD_TYPEDEF;
     }
 
-  /* Go over all arguments and determine the way they should be passed.
-     If it's in a register and there is space for it, let that be so. If
-     not, add it's size to the stack byte count.  */
-  for (bytes = 0, i = 0, avn = cif->nargs; i < avn; i++)
-    {
-      if (examine_argument (cif->arg_types[i], classes, 0, &ngpr, &nsse) == 0
-	  || gprcount + ngpr > MAX_GPR_REGS
-	  || ssecount + nsse > MAX_SSE_REGS)
-	{
-	  long align = cif->arg_types[i]->alignment;
+  state[0] = gprcount;
+  state[1] = state[2] = 0;
+  status = unix64_prep_args (cif, 0, state, &flags);
+  if (status != FFI_OK)
+    return status;
+  if (state[1])
+    flags |= UNIX64_FLAG_XMM_ARGS;
+  if (state[2] == 0 && unix64_simple_args (cif))
+    flags |= UNIX64_FLAG_SIMPLE_ARGS;
 
-	  if (align < 8)
-	    align = 8;
+  cif->flags = flags;
+  cif->bytes = (unsigned) FFI_ALIGN (state[2], 8);
 
-	  bytes = FFI_ALIGN (bytes, align);
-	  bytes += cif->arg_types[i]->size;
-	}
-      else
-	{
-	  gprcount += ngpr;
-	  ssecount += nsse;
-	}
-    }
-  if (ssecount)
+  return FFI_OK;
+}
+
+/* The arguments of a variadic template are assigned once, and only
+   the variadic tail of each call is assigned from where they left
+   off.  The EFI64 ABI has no such state and prepares the whole cif
+   again.  */
+
+ffi_status FFI_HIDDEN
+ffi_prep_var_template_machdep (ffi_var_template *tmpl)
+{
+  unsigned flags = 0;
+
+  if (tmpl->cif.abi != FFI_UNIX64)
+    return FFI_OK;
+
+  tmpl->machdep[0] = (tmpl->cif.flags & UNIX64_FLAG_RET_IN_MEM) != 0;
+  tmpl->machdep[1] = tmpl->machdep[2] = 0;
+  return unix64_prep_args (&tmpl->cif, 0, tmpl->machdep, &flags);
+}
+
+ffi_status FFI_HIDDEN
+ffi_prep_cif_machdep_var_tail (ffi_cif *cif, const ffi_var_template *tmpl)
+{
+  unsigned state[3], flags;
+  ffi_status status;
+
+  if (cif->abi != FFI_UNIX64)
+    return ffi_prep_cif_machdep (cif);
+
+  state[0] = tmpl->machdep[0];
+  state[1] = tmpl->machdep[1];
+  state[2] = tmpl->machdep[2];
+  flags = cif->flags;
+  status = unix64_prep_args (cif, tmpl->nfixedargs, state, &flags);
+  if (status != FFI_OK)
+    return status;
+  if (state[1])
     flags |= UNIX64_FLAG_XMM_ARGS;
+  flags &= ~UNIX64_FLAG_SIMPLE_ARGS;
+  if (state[2] == 0 && unix64_simple_args (cif))
+    flags |= UNIX64_FLAG_SIMPLE_ARGS;
 
   cif->flags = flags;
-  cif->bytes = (unsigned) FFI_ALIGN (bytes, 8);
-
+  cif->bytes = (unsigned) FFI_ALIGN (state[2], 8);
   return FFI_OK;
 }
 
@@ -561,6 +727,9 @@ ffi_call_int (ffi_cif *cif, void (*fn)(void), void *rvalue,
   ffi_type **arg_types;
   int gprcount, ssecount, ngpr, nsse, i, avn, flags;
   struct register_args *reg_args;
+  union big_int_union *sse_hi;
+  size_t hi_size;
+  FFI_STATS_START (ticks);
 
   /* Can't call 32-bit mode from 64-bit mode.  */
   FFI_ASSERT (cif->abi == FFI_UNIX64);
@@ -573,13 +742,24 @@ ffi_call_int (ffi_cif *cif, void (*fn)(void), void *rvalue,
       if (flags & UNIX64_FLAG_RET_IN_MEM)
 	rvalue = alloca (cif->rtype->size);
       else
-	flags = UNIX64_RET_VOID;
+	flags &= UNIX64_FLAG_YMM_ARGS;
     }
 
-  /* Allocate the space for the arguments, plus 4 words of temp space.  */
-  stack = alloca (sizeof (struct register_args) + cif->bytes + 4*8);
-  reg_args = (struct register_args *) stack;
-  argp = stack + sizeof (struct register_args);
+  /* Allocate the space for the arguments, plus 4 words of temp space.
+     If any argument needs a ymm register, the upper halves of ymm0-7
+     go just below the register area, where ffi_call_unix64 finds them.
+     The stack arguments start where %rsp is left for the call; alloca
+     only guarantees 16 bytes, so move them up to a 32-byte boundary
+     for 256-bit vectors passed in memory.  */
+  hi_size = 0;
+  if (flags & UNIX64_FLAG_YMM_ARGS)
+    hi_size = sizeof (*sse_hi) * MAX_SSE_REGS;
+  stack = alloca (hi_size + sizeof (struct register_args) + cif->bytes
+		  + 4*8 + 16);
+  argp = (char *) FFI_ALIGN (stack + hi_size + sizeof (struct register_args),
+			     32);
+  reg_args = (struct register_args *) (argp - sizeof (struct register_args));
+  sse_hi = (union big_int_union *) ((char *) reg_args - hi_size);
 
   reg_args->r10 = (uintptr_t) closure;
 
@@ -593,6 +773,51 @@ ffi_call_int (ffi_cif *cif, void (*fn)(void), void *rvalue,
   avn = cif->nargs;
   arg_types = cif->arg_types;
 
+  /* Scalars each in a register of their own need no classifying.  */
+  if (cif->flags & UNIX64_FLAG_SIMPLE_ARGS)
+    {
+      for (i = 0; i < avn; ++i)
+	{
+	  void *a = avalue[i];
+
+	  switch (arg_types[i]->type)
+	    {
+	    case FFI_TYPE_FLOAT:
+	      memcpy (&reg_args->sse[ssecount++].i32, a, sizeof (UINT32));
+	      break;
+	    case FFI_TYPE_DOUBLE:
+	      memcpy (&reg_args->sse[ssecount++].i64, a, sizeof (UINT64));
+	      break;
+	    case FFI_TYPE_SINT8:
+	      reg_args->gpr[gprcount++] = (SINT64) *((SINT8 *) a);
+	      break;
+	    case FFI_TYPE_SINT16:
+	      reg_args->gpr[gprcount++] = (SINT64) *((SINT16 *) a);
+	      break;
+	    case FFI_TYPE_SINT32:
+	      reg_args->gpr[gprcount++] = (SINT64) *((SINT32 *) a);
+	      break;
+	    case FFI_TYPE_UINT8:
+	      reg_args->gpr[gprcount++] = *((UINT8 *) a);
+	      break;
+	    case FFI_TYPE_UINT16:
+	      reg_args->gpr[gprcount++] = *((UINT16 *) a);
+	      break;
+	    case FFI_TYPE_INT:
+	    case FFI_TYPE_UINT32:
+	      reg_args->gpr[gprcount++] = *((UINT32 *) a);
+	      break;
+	    case FFI_TYPE_POINTER:
+	      reg_args->gpr[gprcount++] = (uintptr_t) *((void **) a);
+	      break;
+	    default:
+	      memcpy (&reg_args->gpr[gprcount++], a, sizeof (UINT64));
+	      break;
+	    }
+	}
+      avn = 0;
+    }
+
   for (i = 0; i < avn; ++i)
     {
       size_t n, size = arg_types[i]->size;
@@ -624,7 +849,14 @@ ffi_call_int (ffi_cif *cif, void (*fn)(void), void *rvalue,
 	      switch (classes[j])
 		{
 		case X86_64_NO_CLASS:
+		  break;
 		case X86_64_SSEUP_CLASS:
+		  /* The rest of a vector: first the high half of the xmm
+		     register, then the upper half of the ymm register.  */
+		  if (j == 1)
+		    memcpy ((char *) &reg_args->sse[ssecount - 1] + 8, a, 8);
+		  else
+		    memcpy ((char *) &sse_hi[ssecount - 1] + (j - 2) * 8, a, 8);
 		  break;
 		case X86_64_INTEGER_CLASS:
 		case X86_64_INTEGERSI_CLASS:
@@ -651,7 +883,11 @@ ffi_call_int (ffi_cif *cif, void (*fn)(void), void *rvalue,
 		  break;
 		case X86_64_SSE_CLASS:
 		case X86_64_SSEDF_CLASS:
-		  memcpy (&reg_args->sse[ssecount++].i64, a, sizeof(UINT64));
+		  /* SIZE counts down the bytes left from this eightbyte on;
+		     a half-precision value, or the tail of a struct, may
+		     end before the eightbyte does.  */
+		  memcpy (&reg_args->sse[ssecount++].i64, a,
+			  size < sizeof(UINT64) ? size : sizeof(UINT64));
 		  break;
 		case X86_64_SSESF_CLASS:
 		  memcpy (&reg_args->sse[ssecount++].i32, a, sizeof(UINT32));
@@ -664,8 +900,34 @@ ffi_call_int (ffi_cif *cif, void (*fn)(void), void *rvalue,
     }
   reg_args->rax = ssecount;
 
-  ffi_call_unix64 (stack, cif->bytes + sizeof (struct register_args),
+  ffi_call_unix64 (reg_args, cif->bytes + sizeof (struct register_args),
 		   flags, rvalue, fn);
+  FFI_STATS_STOP (ticks, cif, 0);
+}
+
+/* Call FN with the registers and stack arguments a forwarding closure
+   received, copied as they are.  Only rax, the upper bound on the
+   number of vector registers used, is not known and is set to the
+   largest value that can be needed.  */
+
+void FFI_HIDDEN
+ffi_frame_forward_machdep (ffi_frame *frame, void (*fn)(void))
+{
+  ffi_cif *cif = frame->cif;
+  struct register_args *reg_args;
+  char *stack;
+
+  /* Aligned as in ffi_call_int.  */
+  stack = alloca (sizeof (struct register_args) + cif->bytes + 4*8 + 16);
+  stack = (char *) FFI_ALIGN (stack + sizeof (struct register_args), 32);
+  reg_args = (struct register_args *) (stack - sizeof (struct register_args));
+  memcpy (reg_args, frame->raw[0], offsetof (struct register_args, rax));
+  memcpy (stack, frame->raw[1], cif->bytes);
+  reg_args->rax = cif->flags & UNIX64_FLAG_XMM_ARGS ? MAX_SSE_REGS : 0;
+  reg_args->r10 = 0;
+
+  ffi_call_unix64 (reg_args, cif->bytes + sizeof (struct register_args),
+		   cif->flags, frame->rvalue, fn);
 }
 
 #ifndef __ILP32__
@@ -695,7 +957,7 @@ ffi_call_go (ffi_cif *cif, void (*fn)(void), void *rvalue,
 {
 #ifndef __ILP32__
   if (cif->abi == FFI_EFI64)
-    ffi_call_go_efi64(cif, fn, rvalue, avalue, closure);
+    return ffi_call_go_efi64(cif, fn, rvalue, avalue, closure);
 #endif
   ffi_call_int (cif, fn, rvalue, avalue, closure);
 }
@@ -703,6 +965,7 @@ ffi_call_go (ffi_cif *cif, void (*fn)(void), void *rvalue,
 
 extern void ffi_closure_unix64(void) FFI_HIDDEN;
 extern void ffi_closure_unix64_sse(void) FFI_HIDDEN;
+extern void ffi_closure_unix64_avx(void) FFI_HIDDEN;
 
 #ifndef __ILP32__
 extern ffi_status
@@ -738,7 +1001,9 @@ ffi_prep_closure_loc (ffi_closure* closure,
   if (cif->abi != FFI_UNIX64)
     return FFI_BAD_ABI;
 
-  if (cif->flags & UNIX64_FLAG_XMM_ARGS)
+  if (cif->flags & UNIX64_FLAG_YMM_ARGS)
+    dest = ffi_closure_unix64_avx;
+  else if (cif->flags & UNIX64_FLAG_XMM_ARGS)
     dest = ffi_closure_unix64_sse;
   else
     dest = ffi_closure_unix64;
@@ -753,6 +1018,18 @@ ffi_prep_closure_loc (ffi_closure* closure,
   return FFI_OK;
 }
 
+ffi_status
+ffi_prep_regs_closure_loc (ffi_closure *closure, ffi_cif *cif,
+			   const ffi_regs_target *target, void *codeloc)
+{
+  if (target == NULL || target->fun == NULL)
+    return FFI_BAD_TYPEDEF;
+  if (cif->abi != FFI_UNIX64)
+    return FFI_BAD_ABI;
+  return ffi_prep_closure_loc (closure, cif, ffi_regs_closure_marker,
+			       (void *) target, codeloc);
+}
+
 int FFI_HIDDEN
 ffi_closure_unix64_inner(ffi_cif *cif,
 			 void (*fun)(ffi_cif*, void*, void**, void*),
@@ -766,6 +1043,11 @@ ffi_closure_unix64_inner(ffi_cif *cif,
   long i, avn;
   int gprcount, ssecount, ngpr, nsse;
   int flags;
+  /* ffi_closure_unix64_avx saves the upper halves of ymm0-7 directly
+     after the xmm registers, where rax and r10 live for a call.  */
+  union big_int_union *sse_hi = (union big_int_union *) &reg_args->rax;
+  void *ret_copy = NULL;
+  FFI_STATS_START (ticks);
 
   avn = cif->nargs;
   flags = cif->flags;
@@ -781,8 +1063,66 @@ ffi_closure_unix64_inner(ffi_cif *cif,
       rvalue = r;
       flags = (sizeof(void *) == 4 ? UNIX64_RET_UINT32 : UNIX64_RET_INT64);
     }
+  /* The return slot in the closure frame is only 16-byte aligned;
+     give a 256-bit vector result properly aligned storage.  */
+  else if ((flags & 0xff) == UNIX64_RET_YMM256)
+    {
+      ret_copy = rvalue;
+      rvalue = (void *) FFI_ALIGN (alloca (64), 32);
+    }
+
+  /* A register-frame closure reads the saved registers and the stack
+     arguments itself.  struct register_args is laid out as ffi_regs,
+     with the upper ymm halves where rax and r10 are.  */
+  if (fun == ffi_regs_closure_marker)
+    {
+      const ffi_regs_target *target = user_data;
+
+      target->fun (cif, rvalue, (ffi_regs *) reg_args, argp,
+		   target->user_data);
+      FFI_STATS_STOP (ticks, cif, 1);
+      if (ret_copy)
+	memcpy (ret_copy, rvalue, 32);
+      return flags;
+    }
+
+  /* A forwarding closure gets the saved registers and the stack
+     arguments as they are; ffi_frame_forward_machdep passes them on.
+     Upper ymm halves overlap rax and r10 in the register area, so
+     those cifs take the generic path.  */
+  if (fun == ffi_forward_dispatch
+      && !(cif->flags & UNIX64_FLAG_YMM_ARGS) && ret_copy == NULL)
+    {
+      const ffi_forward_target *target = user_data;
+      ffi_frame frame;
+
+      frame.cif = cif;
+      frame.rvalue = rvalue;
+      frame.avalue = NULL;
+      frame.raw[0] = reg_args;
+      frame.raw[1] = argp;
+      target->fun (cif, rvalue, &frame, target->user_data);
+      FFI_STATS_STOP (ticks, cif, 1);
+      return flags;
+    }
 
   arg_types = cif->arg_types;
+
+  /* Scalars each in a register of their own are used in place.  */
+  if (cif->flags & UNIX64_FLAG_SIMPLE_ARGS)
+    {
+      for (i = 0; i < avn; ++i)
+	{
+	  unsigned short t = arg_types[i]->type;
+
+	  if (t == FFI_TYPE_FLOAT || t == FFI_TYPE_DOUBLE)
+	    avalue[i] = &reg_args->sse[ssecount++];
+	  else
+	    avalue[i] = &reg_args->gpr[gprcount++];
+	}
+      avn = 0;
+    }
+
   for (i = 0; i < avn; ++i)
     {
       enum x86_64_reg_class classes[MAX_CLASSES];
@@ -821,6 +1161,29 @@ ffi_closure_unix64_inner(ffi_cif *cif,
 	      avalue[i] = &reg_args->gpr[gprcount];
 	      gprcount += n;
 	    }
+	  /* A 128-bit integer that starts in an odd-numbered register
+	     is only 8-byte aligned in the save area.  */
+	  if (arg_types[i]->alignment > 8 && ((uintptr_t) avalue[i] & 15))
+	    {
+	      char *a = (char *) FFI_ALIGN (alloca (32), 16);
+	      memcpy (a, avalue[i], arg_types[i]->size);
+	      avalue[i] = a;
+	    }
+	}
+      /* A vector in an xmm register can also be used directly; one in
+	 a ymm register has to be put back together.  */
+      else if (classes[1] == X86_64_SSEUP_CLASS)
+	{
+	  if (n == 2)
+	    avalue[i] = &reg_args->sse[ssecount];
+	  else
+	    {
+	      char *a = (char *) FFI_ALIGN (alloca (64), 32);
+	      memcpy (a, &reg_args->sse[ssecount], 16);
+	      memcpy (a + 16, &sse_hi[ssecount], 16);
+	      avalue[i] = a;
+	    }
+	  ssecount++;
 	}
       /* Otherwise, allocate space to make them consecutive.  */
       else
@@ -841,13 +1204,77 @@ ffi_closure_unix64_inner(ffi_cif *cif,
 
   /* Invoke the closure.  */
   fun (cif, rvalue, avalue, user_data);
+  FFI_STATS_STOP (ticks, cif, 1);
+
+  if (ret_copy)
+    memcpy (ret_copy, rvalue, 32);
 
   /* Tell assembly how to perform return type promotions.  */
   return flags;
 }
 
+#ifdef FFI_TARGET_HAS_COMPACT_CLOSURE
+extern void ffi_compact_closure_unix64(void) FFI_HIDDEN;
+extern void ffi_compact_closure_unix64_sse(void) FFI_HIDDEN;
+extern void ffi_compact_closure_unix64_avx(void) FFI_HIDDEN;
+
+ffi_status
+ffi_prep_closure_desc (ffi_closure_desc *desc, ffi_cif *cif,
+		       void (*fun)(ffi_cif*, void*, void**, void*))
+{
+  void (*dest)(void);
+
+  if (cif->abi != FFI_UNIX64)
+    return FFI_BAD_ABI;
+
+  if (cif->flags & UNIX64_FLAG_YMM_ARGS)
+    dest = ffi_compact_closure_unix64_avx;
+  else if (cif->flags & UNIX64_FLAG_XMM_ARGS)
+    dest = ffi_compact_closure_unix64_sse;
+  else
+    dest = ffi_compact_closure_unix64;
+
+  desc->cif = cif;
+  desc->fun = fun;
+  desc->entry = (void *) dest;
+
+  return FFI_OK;
+}
+
+/* The trampoline of a compact closure finds its descriptor through
+   itself and jumps to the entry point the descriptor names, which
+   loads the cif and function from the descriptor.  */
+
+ffi_status
+ffi_prep_compact_closure_loc (ffi_compact_closure *closure,
+			      const ffi_closure_desc *desc,
+			      void *user_data, void *codeloc)
+{
+  static const unsigned char trampoline[UNIX64_COMPACT_TRAMP_SIZE] = {
+    /* leaq  -0x7(%rip),%r10   # 0x0  */
+    0x4c, 0x8d, 0x15, 0xf9, 0xff, 0xff, 0xff,
+    /* movq  0x10(%r10),%r11   # desc */
+    0x4d, 0x8b, 0x5a, UNIX64_COMPACT_DESC,
+    /* jmpq  *0x10(%r11)       # desc->entry */
+    0x41, 0xff, 0x63, 0x10,
+    /* nop */
+    0x90
+  };
+
+  if (desc == NULL || desc->entry == NULL)
+    return FFI_BAD_TYPEDEF;
+
+  memcpy (closure->tramp, trampoline, sizeof (trampoline));
+  closure->desc = desc;
+  closure->user_data = user_data;
+
+  return FFI_OK;
+}
+#endif
+
 extern void ffi_go_closure_unix64(void) FFI_HIDDEN;
 extern void ffi_go_closure_unix64_sse(void) FFI_HIDDEN;
+extern void ffi_go_closure_unix64_avx(void) FFI_HIDDEN;
 
 #ifndef __ILP32__
 extern ffi_status
@@ -866,13 +1293,97 @@ ffi_prep_go_closure (ffi_go_closure* closure, ffi_cif* cif,
   if (cif->abi != FFI_UNIX64)
     return FFI_BAD_ABI;
 
-  closure->tramp = (cif->flags & UNIX64_FLAG_XMM_ARGS
-		    ? ffi_go_closure_unix64_sse
-		    : ffi_go_closure_unix64);
+  if (cif->flags & UNIX64_FLAG_YMM_ARGS)
+    closure->tramp = ffi_go_closure_unix64_avx;
+  else if (cif->flags & UNIX64_FLAG_XMM_ARGS)
+    closure->tramp = ffi_go_closure_unix64_sse;
+  else
+    closure->tramp = ffi_go_closure_unix64;
   closure->cif = cif;
   closure->fun = fun;
 
   return FFI_OK;
 }
 
+/* Each thunk table entry is a 16-byte stub that points r10 at its slot
+   and jumps to the Go closure entry through the pointer at the start
+   of the block.  The slots follow the stubs and are laid out like an
+   ffi_go_closure, with the table where the trampoline would be, so the
+   entry passes the slot on as the user data.  */
+
+struct thunk_slot
+{
+  ffi_thunk_table *table;
+  ffi_cif *cif;
+  void (*fun)(ffi_cif*, void*, void**, void*);
+};
+
+#define THUNK_HEADER_SIZE	16
+#define THUNK_STUB_SIZE		16
+
+ffi_status FFI_HIDDEN
+ffi_prep_thunk_table_machdep (ffi_thunk_table *table)
+{
+  static const unsigned char stub[THUNK_STUB_SIZE] = {
+    /* leaq  slot(%rip),%r10   # 0x0  */
+    0x4c, 0x8d, 0x15, 0x00, 0x00, 0x00, 0x00,
+    /* jmpq  *dest(%rip)       # 0x7  */
+    0xff, 0x25, 0x00, 0x00, 0x00, 0x00,
+    /* nopl  (%rax) */
+    0x0f, 0x1f, 0x00
+  };
+  ffi_cif *cif = table->cif;
+  size_t n = table->count, i;
+  char *mem, *code, *stubs;
+  struct thunk_slot *slots;
+  void (*dest)(void);
+
+  /* Every displacement has to fit in 32 bits; huge tables are left to
+     the generic code.  */
+  if (cif->abi != FFI_UNIX64
+      || n > (0x7fffffff - THUNK_HEADER_SIZE)
+	     / (THUNK_STUB_SIZE + sizeof (struct thunk_slot)))
+    return FFI_BAD_ABI;
+
+  mem = ffi_closure_alloc (THUNK_HEADER_SIZE
+			   + n * (THUNK_STUB_SIZE + sizeof (struct thunk_slot)),
+			   (void **) &code);
+  if (mem == NULL)
+    return FFI_BAD_TYPEDEF;
+
+  if (cif->flags & UNIX64_FLAG_YMM_ARGS)
+    dest = ffi_go_closure_unix64_avx;
+  else if (cif->flags & UNIX64_FLAG_XMM_ARGS)
+    dest = ffi_go_closure_unix64_sse;
+  else
+    dest = ffi_go_closure_unix64;
+  *(UINT64 *) mem = (uintptr_t) dest;
+
+  /* The displacements are the same in the code and data views.  */
+  stubs = mem + THUNK_HEADER_SIZE;
+  slots = (struct thunk_slot *) (stubs + n * THUNK_STUB_SIZE);
+  for (i = 0; i < n; i++)
+    {
+      char *p = stubs + i * THUNK_STUB_SIZE;
+      SINT32 disp;
+
+      memcpy (p, stub, sizeof (stub));
+      disp = (SINT32) ((char *) &slots[i] - (p + 7));
+      memcpy (p + 3, &disp, sizeof (disp));
+      disp = (SINT32) (mem - (p + 13));
+      memcpy (p + 9, &disp, sizeof (disp));
+
+      slots[i].table = table;
+      slots[i].cif = cif;
+      slots[i].fun = ffi_thunk_dispatch;
+    }
+
+  table->mem = mem;
+  table->code = code + THUNK_HEADER_SIZE;
+  table->stride = THUNK_STUB_SIZE;
+  table->slots = code + ((char *) slots - mem);
+  table->slot_size = sizeof (struct thunk_slot);
+  return FFI_OK;
+}
+
 #endif /* __x86_64__ */
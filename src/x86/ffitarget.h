@@ -54,6 +54,27 @@
 #define FFI_TARGET_HAS_COMPLEX_TYPE
 #endif
 
+/* Structures are classified without expanding array members, or only
+   by their size.  */
+#define FFI_TARGET_HAS_ARRAY_TYPE
+
+/* SIMD vectors, 128-bit integers and half-precision floats are only
+   supported by the unix64 ABI.  */
+#if defined (__x86_64__) && !defined (X86_WIN64) && !defined (_MSC_VER)
+#define FFI_TARGET_HAS_VECTOR_TYPE
+#define FFI_TARGET_HAS_INT128_TYPE
+#define FFI_TARGET_HAS_FLOAT16_TYPE
+#endif
+
+/* The unix64 code can prepare the variadic tail of a cif on its own,
+   pass the incoming frame of a forwarding closure on unchanged and
+   build thunk tables with compact entries.  */
+#ifdef X86_64
+#define FFI_TARGET_HAS_VARIADIC_TAIL
+#define FFI_TARGET_HAS_FORWARD_FRAME
+#define FFI_TARGET_HAS_THUNK_TABLE
+#endif
+
 /* ---- Generic type definitions ----------------------------------------- */
 
 #ifndef LIBFFI_ASM
@@ -143,5 +164,30 @@ typedef enum ffi_abi {
 # define FFI_NATIVE_RAW_API 1  /* x86 has native raw api support */
 #endif
 
+/* Compact closures keep only a 16-byte trampoline, a descriptor
+   pointer and the user data; see ffi_compact_closure.  */
+#if defined (X86_64) && !defined (__ILP32__)
+#define FFI_TARGET_HAS_COMPACT_CLOSURE
+#define FFI_COMPACT_TRAMPOLINE_SIZE 16
+#endif
+
+/* The argument registers saved on entry to a unix64 closure, as a
+   register-frame closure sees them: rdi, rsi, rdx, rcx, r8 and r9,
+   then xmm0-7, then the upper halves of ymm0-7.  The vector registers
+   are only saved when the cif passes arguments in them, and the upper
+   halves only when it passes 256-bit vectors.  */
+#ifdef X86_64
+#define FFI_TARGET_HAS_REGS_CLOSURE
+#define FFI_REGS_NGPR 6
+#define FFI_REGS_NVEC 8
+#ifndef LIBFFI_ASM
+typedef struct {
+  unsigned long long gpr[FFI_REGS_NGPR];
+  unsigned char vec[FFI_REGS_NVEC][16];
+  unsigned char vec_hi[FFI_REGS_NVEC][16];
+} ffi_regs;
+#endif
+#endif
+
 #endif
 
@@ -48,10 +48,54 @@ struct win64_call_frame
 extern void ffi_call_win64 (void *stack, struct win64_call_frame *,
 			    void *closure) FFI_HIDDEN;
 
+/* The low byte of cif->flags holds the return type code that
+   ffi_call_win64 dispatches on.  Above it, three bits per argument
+   record how each of the first WIN64_PLAN_ARGS arguments moves between
+   its value and its 8 byte slot, so that the call and closure paths
+   need not look at the argument types again.  */
+#define WIN64_FLAGS_RET_MASK	0xff
+#define WIN64_PLAN_SHIFT	8
+#define WIN64_PLAN_BITS		3
+#define WIN64_PLAN_ARGS		((32 - WIN64_PLAN_SHIFT) / WIN64_PLAN_BITS)
+
+#define WIN64_ARG_8		0
+#define WIN64_ARG_4		1
+#define WIN64_ARG_2		2
+#define WIN64_ARG_1		3
+#define WIN64_ARG_REF		4
+#define WIN64_ARG_FLOAT		5
+#define WIN64_ARG_DOUBLE	6
+
+static int
+win64_arg_kind (const ffi_type *type)
+{
+  if (type->type == FFI_TYPE_FLOAT)
+    return WIN64_ARG_FLOAT;
+  if (type->type == FFI_TYPE_DOUBLE)
+    return WIN64_ARG_DOUBLE;
+
+  /* Each argument either fits in a register, an 8 byte slot, or is
+     passed by reference with the pointer in the 8 byte slot.  */
+  switch (type->size)
+    {
+    case 8:
+      return WIN64_ARG_8;
+    case 4:
+      return WIN64_ARG_4;
+    case 2:
+      return WIN64_ARG_2;
+    case 1:
+      return WIN64_ARG_1;
+    default:
+      return WIN64_ARG_REF;
+    }
+}
+
 ffi_status
 EFI64(ffi_prep_cif_machdep)(ffi_cif *cif)
 {
   int flags, n;
+  unsigned plan = 0;
 
   switch (cif->abi)
     {
@@ -67,6 +111,12 @@ EFI64(ffi_prep_cif_machdep)(ffi_cif *cif)
     {
     default:
       break;
+    case FFI_TYPE_VECTOR:
+    case FFI_TYPE_UINT128:
+    case FFI_TYPE_SINT128:
+    case FFI_TYPE_FLOAT16:
+    case FFI_TYPE_BFLOAT16:
+      return FFI_BAD_TYPEDEF;
     case FFI_TYPE_LONGDOUBLE:
       /* GCC returns long double values by reference, like a struct */
       if (cif->abi == FFI_GNUW64)
@@ -93,10 +143,24 @@ EFI64(ffi_prep_cif_machdep)(ffi_cif *cif)
 	}
       break;
     }
-  cif->flags = flags;
 
-  /* Each argument either fits in a register, an 8 byte slot, or is
-     passed by reference with the pointer in the 8 byte slot.  */
+  for (n = 0; n < cif->nargs; n++)
+    {
+      switch (cif->arg_types[n]->type)
+	{
+	case FFI_TYPE_VECTOR:
+	case FFI_TYPE_UINT128:
+	case FFI_TYPE_SINT128:
+	case FFI_TYPE_FLOAT16:
+	case FFI_TYPE_BFLOAT16:
+	  return FFI_BAD_TYPEDEF;
+	}
+      if (n < WIN64_PLAN_ARGS)
+	plan |= (unsigned) win64_arg_kind (cif->arg_types[n])
+		<< (n * WIN64_PLAN_BITS);
+    }
+  cif->flags = flags | (plan << WIN64_PLAN_SHIFT);
+
   n = cif->nargs;
   n += (flags == FFI_TYPE_STRUCT);
   if (n < 4)
@@ -111,13 +175,16 @@ ffi_call_int (ffi_cif *cif, void (*fn)(void), void *rvalue,
 	      void **avalue, void *closure)
 {
   int i, j, n, flags;
+  unsigned plan;
   UINT64 *stack;
   size_t rsize;
   struct win64_call_frame *frame;
+  FFI_STATS_START (ticks);
 
   FFI_ASSERT(cif->abi == FFI_GNUW64 || cif->abi == FFI_WIN64);
 
-  flags = cif->flags;
+  flags = cif->flags & WIN64_FLAGS_RET_MASK;
+  plan = cif->flags >> WIN64_PLAN_SHIFT;
   rsize = 0;
 
   /* If we have no return value for a structure, we need to create one.
@@ -146,20 +213,26 @@ ffi_call_int (ffi_cif *cif, void (*fn)(void), void *rvalue,
       j = 1;
     }
 
-  for (i = 0, n = cif->nargs; i < n; ++i, ++j)
+  for (i = 0, n = cif->nargs; i < n; ++i, ++j, plan >>= WIN64_PLAN_BITS)
     {
-      switch (cif->arg_types[i]->size)
+      int kind = (i < WIN64_PLAN_ARGS
+		  ? (int) (plan & ((1u << WIN64_PLAN_BITS) - 1))
+		  : win64_arg_kind (cif->arg_types[i]));
+
+      switch (kind)
 	{
-	case 8:
+	case WIN64_ARG_8:
+	case WIN64_ARG_DOUBLE:
 	  stack[j] = *(UINT64 *)avalue[i];
 	  break;
-	case 4:
+	case WIN64_ARG_4:
+	case WIN64_ARG_FLOAT:
 	  stack[j] = *(UINT32 *)avalue[i];
 	  break;
-	case 2:
+	case WIN64_ARG_2:
 	  stack[j] = *(UINT16 *)avalue[i];
 	  break;
-	case 1:
+	case WIN64_ARG_1:
 	  stack[j] = *(UINT8 *)avalue[i];
 	  break;
 	default:
@@ -169,6 +242,7 @@ ffi_call_int (ffi_cif *cif, void (*fn)(void), void *rvalue,
     }
 
   ffi_call_win64 (stack, frame, closure);
+  FFI_STATS_STOP (ticks, cif, 0);
 }
 
 void
@@ -265,6 +339,8 @@ ffi_closure_win64_inner(ffi_cif *cif,
   void **avalue;
   void *rvalue;
   int i, n, nreg, flags;
+  unsigned plan;
+  FFI_STATS_START (ticks);
 
   avalue = alloca(cif->nargs * sizeof(void *));
   rvalue = frame->rvalue;
@@ -273,7 +349,8 @@ ffi_closure_win64_inner(ffi_cif *cif,
   /* When returning a structure, the address is in the first argument.
      We must also be prepared to return the same address in eax, so
      install that address in the frame and pretend we return a pointer.  */
-  flags = cif->flags;
+  flags = cif->flags & WIN64_FLAGS_RET_MASK;
+  plan = cif->flags >> WIN64_PLAN_SHIFT;
   if (flags == FFI_TYPE_STRUCT)
     {
       rvalue = (void *)(uintptr_t)frame->args[0];
@@ -281,20 +358,21 @@ ffi_closure_win64_inner(ffi_cif *cif,
       nreg = 1;
     }
 
-  for (i = 0, n = cif->nargs; i < n; ++i, ++nreg)
+  for (i = 0, n = cif->nargs; i < n; ++i, ++nreg, plan >>= WIN64_PLAN_BITS)
     {
-      size_t size = cif->arg_types[i]->size;
-      size_t type = cif->arg_types[i]->type;
+      int kind = (i < WIN64_PLAN_ARGS
+		  ? (int) (plan & ((1u << WIN64_PLAN_BITS) - 1))
+		  : win64_arg_kind (cif->arg_types[i]));
       void *a;
 
-      if (type == FFI_TYPE_DOUBLE || type == FFI_TYPE_FLOAT)
+      if (kind == WIN64_ARG_DOUBLE || kind == WIN64_ARG_FLOAT)
 	{
 	  if (nreg < 4)
 	    a = &frame->fargs[nreg];
 	  else
 	    a = &frame->args[nreg];
 	}
-      else if (size == 1 || size == 2 || size == 4 || size == 8)
+      else if (kind != WIN64_ARG_REF)
 	a = &frame->args[nreg];
       else
 	a = (void *)(uintptr_t)frame->args[nreg];
@@ -304,5 +382,6 @@ ffi_closure_win64_inner(ffi_cif *cif,
 
   /* Invoke the closure.  */
   fun (cif, rvalue, avalue, user_data);
+  FFI_STATS_STOP (ticks, cif, 1);
   return flags;
 }
@@ -18,6 +18,23 @@
 #define X86_RET_TYPE_MASK	15
 #define X86_RET_POP_SHIFT	4
 
+/* How each of the first X86_PLAN_ARGS arguments is passed, recorded in
+   cif->flags above the return type.  The low bits give the extension
+   or copy, and X86_ARG_REG is set for a register argument.  */
+#define X86_ARG_INT32		0
+#define X86_ARG_SINT8		1
+#define X86_ARG_UINT8		2
+#define X86_ARG_SINT16		3
+#define X86_ARG_UINT16		4
+#define X86_ARG_MEM		5
+#define X86_ARG_MEM16		6
+#define X86_ARG_REG		8
+
+#define X86_ARG_BITS		4
+#define X86_ARG_MASK		15
+#define X86_PLAN_SHIFT		4
+#define X86_PLAN_ARGS		7
+
 #define R_EAX	0
 #define R_EDX	1
 #define R_ECX	2
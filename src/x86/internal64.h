@@ -14,9 +14,20 @@
 #define UNIX64_RET_ST_RAX_XMM0	13
 #define UNIX64_RET_ST_XMM0_XMM1	14
 #define UNIX64_RET_ST_RAX_RDX	15
+#define UNIX64_RET_XMM128	16
+#define UNIX64_RET_YMM256	17
+#define UNIX64_RET_XMM16	18
 
-#define UNIX64_RET_LAST		15
+#define UNIX64_RET_LAST		18
 
+#define UNIX64_FLAG_SIMPLE_ARGS	(1 << 8)
+#define UNIX64_FLAG_YMM_ARGS	(1 << 9)
 #define UNIX64_FLAG_RET_IN_MEM	(1 << 10)
 #define UNIX64_FLAG_XMM_ARGS	(1 << 11)
 #define UNIX64_SIZE_SHIFT	12
+
+/* A compact closure is a 16-byte trampoline followed by pointers to its
+   descriptor and to its user data.  */
+#define UNIX64_COMPACT_TRAMP_SIZE	16
+#define UNIX64_COMPACT_DESC		16
+#define UNIX64_COMPACT_USER_DATA	24
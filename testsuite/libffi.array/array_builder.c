@@ -0,0 +1,55 @@
+/* Area:	ffi_type_builder, ffi_call
+   Purpose:	Check array members built in an arena.
+   Limitations:	none.
+   PR:		none.
+   Originator:	libffi  */
+
+/* { dg-do run } */
+#include "ffitest.h"
+#include <stddef.h>
+
+typedef struct
+{
+  int n;
+  double v[3];
+} vec_t;
+
+static double
+vec_sum (vec_t v)
+{
+  return v.n + v.v[0] + v.v[1] + v.v[2];
+}
+
+int main (void)
+{
+  ffi_type_builder *b;
+  ffi_type *arr, *vec, *elts[2];
+  size_t offsets[2];
+  ffi_cif cif;
+  void *values[1];
+  vec_t v = { 1, { 2.0, 3.0, 4.0 } };
+  double res;
+
+  b = ffi_type_builder_new (FFI_DEFAULT_ABI, 0);
+  CHECK(b != NULL);
+
+  arr = ffi_type_builder_array (b, &ffi_type_double, 3);
+  CHECK(arr != NULL && arr->size == 3 * sizeof (double));
+  CHECK(ffi_type_builder_array (b, &ffi_type_double, 0) == NULL);
+
+  elts[0] = &ffi_type_sint;
+  elts[1] = arr;
+  vec = ffi_type_builder_struct (b, 2, elts, offsets);
+  CHECK(vec != NULL && vec->size == sizeof (vec_t));
+  CHECK(offsets[1] == offsetof (vec_t, v));
+
+  CHECK(ffi_prep_cif (&cif, FFI_DEFAULT_ABI, 1, &ffi_type_double, &vec)
+	== FFI_OK);
+  values[0] = &v;
+  ffi_call (&cif, FFI_FN(vec_sum), &res, values);
+  printf ("vec_sum: %g\n", res);
+  CHECK(res == 10.0);
+
+  ffi_type_builder_free (b);
+  exit(0);
+}
@@ -0,0 +1,160 @@
+/* Area:	ffi_call, ffi_get_struct_offsets
+   Purpose:	Check structures with array members.
+   Limitations:	none.
+   PR:		none.
+   Originator:	libffi  */
+
+/* { dg-do run } */
+#include "ffitest.h"
+
+#define BIG 4096
+
+typedef struct { double m[BIG]; } big_t;
+typedef struct { float a; float b[3]; } f4_t;
+typedef struct { char c[3]; short s; int i[2]; } mix_t;
+
+static double
+sum_big (big_t b, int n)
+{
+  double s = 0;
+  int i;
+
+  for (i = 0; i < n; i++)
+    s += b.m[i];
+  return s;
+}
+
+static f4_t
+scale_f4 (f4_t x, float k)
+{
+  f4_t r = { x.a * k, { x.b[0] * k, x.b[1] * k, x.b[2] * k } };
+  return r;
+}
+
+static mix_t
+bump_mix (mix_t x)
+{
+  x.c[0]++; x.c[2]++; x.s++; x.i[0]++; x.i[1]++;
+  return x;
+}
+
+int main (void)
+{
+  ffi_cif cif;
+  ffi_type *args[2];
+  void *values[2];
+  size_t offsets[3];
+
+  ffi_type *big_elts[2], *big_arr_elts[2];
+  ffi_type big_type, big_arr;
+  ffi_type *f4_elts[3], *f3_elts[2];
+  ffi_type f4_type, f3_arr;
+  ffi_type *mix_elts[4], *c3_elts[2], *i2_elts[2];
+  ffi_type mix_type, c3_arr, i2_arr;
+
+  static big_t b;
+  f4_t f = { 1, { 2, 3, 4 } }, fr;
+  mix_t x = { { 1, 2, 3 }, 4, { 5, 6 } }, xr;
+  double d;
+  float k = 2;
+  int i, n = BIG;
+
+  /* struct { double m[4096]; } needs one element pointer, not 4096.  */
+  big_arr_elts[0] = &ffi_type_double;
+  big_arr_elts[1] = NULL;
+  big_arr.size = big_arr.alignment = 0;
+  big_arr.type = FFI_TYPE_ARRAY;
+  big_arr.elements = big_arr_elts;
+  CHECK(ffi_prep_array_type(&big_arr, BIG) == FFI_OK);
+  CHECK(big_arr.size == sizeof (b.m));
+
+  big_elts[0] = &big_arr;
+  big_elts[1] = NULL;
+  big_type.size = big_type.alignment = 0;
+  big_type.type = FFI_TYPE_STRUCT;
+  big_type.elements = big_elts;
+
+  for (i = 0; i < BIG; i++)
+    b.m[i] = i;
+
+  args[0] = &big_type;
+  args[1] = &ffi_type_sint;
+  values[0] = &b;
+  values[1] = &n;
+  CHECK(ffi_prep_cif(&cif, FFI_DEFAULT_ABI, 2, &ffi_type_double, args)
+	== FFI_OK);
+  CHECK(big_type.size == sizeof (big_t));
+  ffi_call(&cif, FFI_FN(sum_big), &d, values);
+  printf ("%g\n", d);
+  CHECK(d == (double) BIG * (BIG - 1) / 2);
+
+  /* A homogeneous float aggregate split over a scalar and an array.  */
+  f3_elts[0] = &ffi_type_float;
+  f3_elts[1] = NULL;
+  f3_arr.size = f3_arr.alignment = 0;
+  f3_arr.type = FFI_TYPE_ARRAY;
+  f3_arr.elements = f3_elts;
+  CHECK(ffi_prep_array_type(&f3_arr, 3) == FFI_OK);
+
+  f4_elts[0] = &ffi_type_float;
+  f4_elts[1] = &f3_arr;
+  f4_elts[2] = NULL;
+  f4_type.size = f4_type.alignment = 0;
+  f4_type.type = FFI_TYPE_STRUCT;
+  f4_type.elements = f4_elts;
+
+  args[0] = &f4_type;
+  args[1] = &ffi_type_float;
+  values[0] = &f;
+  values[1] = &k;
+  CHECK(ffi_prep_cif(&cif, FFI_DEFAULT_ABI, 2, &f4_type, args) == FFI_OK);
+  ffi_call(&cif, FFI_FN(scale_f4), &fr, values);
+  printf ("%g %g %g %g\n", fr.a, fr.b[0], fr.b[1], fr.b[2]);
+  CHECK(fr.a == 2 && fr.b[0] == 4 && fr.b[1] == 6 && fr.b[2] == 8);
+
+  /* Mixed members, and the offsets seen by ffi_get_struct_offsets.  */
+  c3_elts[0] = &ffi_type_schar;
+  c3_elts[1] = NULL;
+  c3_arr.size = c3_arr.alignment = 0;
+  c3_arr.type = FFI_TYPE_ARRAY;
+  c3_arr.elements = c3_elts;
+  CHECK(ffi_prep_array_type(&c3_arr, 3) == FFI_OK);
+
+  i2_elts[0] = &ffi_type_sint;
+  i2_elts[1] = NULL;
+  i2_arr.size = i2_arr.alignment = 0;
+  i2_arr.type = FFI_TYPE_ARRAY;
+  i2_arr.elements = i2_elts;
+  CHECK(ffi_prep_array_type(&i2_arr, 2) == FFI_OK);
+
+  mix_elts[0] = &c3_arr;
+  mix_elts[1] = &ffi_type_sshort;
+  mix_elts[2] = &i2_arr;
+  mix_elts[3] = NULL;
+  mix_type.size = mix_type.alignment = 0;
+  mix_type.type = FFI_TYPE_STRUCT;
+  mix_type.elements = mix_elts;
+
+  CHECK(ffi_get_struct_offsets(FFI_DEFAULT_ABI, &mix_type, offsets) == FFI_OK);
+  CHECK(offsets[0] == offsetof (mix_t, c));
+  CHECK(offsets[1] == offsetof (mix_t, s));
+  CHECK(offsets[2] == offsetof (mix_t, i));
+  CHECK(mix_type.size == sizeof (mix_t));
+
+  args[0] = &mix_type;
+  values[0] = &x;
+  CHECK(ffi_prep_cif(&cif, FFI_DEFAULT_ABI, 1, &mix_type, args) == FFI_OK);
+  ffi_call(&cif, FFI_FN(bump_mix), &xr, values);
+  printf ("%d %d %d %d %d %d\n", xr.c[0], xr.c[1], xr.c[2], xr.s,
+	  xr.i[0], xr.i[1]);
+  CHECK(xr.c[0] == 2 && xr.c[1] == 2 && xr.c[2] == 4 && xr.s == 5
+	&& xr.i[0] == 6 && xr.i[1] == 7);
+
+  /* Arrays cannot be passed or returned on their own.  */
+  args[0] = &i2_arr;
+  CHECK(ffi_prep_cif(&cif, FFI_DEFAULT_ABI, 1, &ffi_type_void, args)
+	== FFI_BAD_TYPEDEF);
+  CHECK(ffi_prep_array_type(&i2_arr, 0) == FFI_BAD_TYPEDEF);
+
+  exit(0);
+}
@@ -0,0 +1,79 @@
+/* Area:	closure_call
+   Purpose:	Check structures with array members passed to and
+		returned from closures.
+   Limitations:	none.
+   PR:		none.
+   Originator:	libffi  */
+
+/* { dg-do run } */
+#include "ffitest.h"
+
+typedef struct { float a; float b[3]; } f4_t;
+typedef struct { double d; long l[2]; } dl_t;
+
+static void
+cls_f4_fn (ffi_cif *cif __UNUSED__, void *resp, void **args,
+	   void *userdata __UNUSED__)
+{
+  f4_t x = *(f4_t *) args[0];
+  dl_t y = *(dl_t *) args[1];
+  f4_t r = { x.a + (float) y.d,
+	     { x.b[0] + y.l[0], x.b[1] + y.l[1], x.b[2] } };
+
+  *(f4_t *) resp = r;
+}
+
+typedef f4_t (*cls_f4) (f4_t, dl_t);
+
+int main (void)
+{
+  ffi_cif cif;
+  void *code;
+  ffi_closure *pcl = ffi_closure_alloc (sizeof (ffi_closure), &code);
+  ffi_type *args[2];
+  ffi_type *f4_elts[3], *f3_elts[2], *dl_elts[3], *l2_elts[2];
+  ffi_type f4_type, f3_arr, dl_type, l2_arr;
+  f4_t x = { 1, { 2, 3, 4 } }, r;
+  dl_t y = { 0.5, { 10, 20 } };
+
+  f3_elts[0] = &ffi_type_float;
+  f3_elts[1] = NULL;
+  f3_arr.size = f3_arr.alignment = 0;
+  f3_arr.type = FFI_TYPE_ARRAY;
+  f3_arr.elements = f3_elts;
+  CHECK(ffi_prep_array_type(&f3_arr, 3) == FFI_OK);
+
+  f4_elts[0] = &ffi_type_float;
+  f4_elts[1] = &f3_arr;
+  f4_elts[2] = NULL;
+  f4_type.size = f4_type.alignment = 0;
+  f4_type.type = FFI_TYPE_STRUCT;
+  f4_type.elements = f4_elts;
+
+  l2_elts[0] = &ffi_type_slong;
+  l2_elts[1] = NULL;
+  l2_arr.size = l2_arr.alignment = 0;
+  l2_arr.type = FFI_TYPE_ARRAY;
+  l2_arr.elements = l2_elts;
+  CHECK(ffi_prep_array_type(&l2_arr, 2) == FFI_OK);
+
+  dl_elts[0] = &ffi_type_double;
+  dl_elts[1] = &l2_arr;
+  dl_elts[2] = NULL;
+  dl_type.size = dl_type.alignment = 0;
+  dl_type.type = FFI_TYPE_STRUCT;
+  dl_type.elements = dl_elts;
+
+  args[0] = &f4_type;
+  args[1] = &dl_type;
+
+  CHECK(ffi_prep_cif(&cif, FFI_DEFAULT_ABI, 2, &f4_type, args) == FFI_OK);
+  CHECK(ffi_prep_closure_loc(pcl, &cif, cls_f4_fn, NULL, code) == FFI_OK);
+
+  r = ((cls_f4) code) (x, y);
+  printf ("%g %g %g %g\n", r.a, r.b[0], r.b[1], r.b[2]);
+  CHECK(r.a == 1.5f && r.b[0] == 12 && r.b[1] == 23 && r.b[2] == 4);
+
+  ffi_closure_free (pcl);
+  exit(0);
+}
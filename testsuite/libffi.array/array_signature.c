@@ -0,0 +1,46 @@
+/* Area:	ffi_prep_cif_from_string, ffi_call
+   Purpose:	Check array members in signature strings.
+   Limitations:	none.
+   PR:		none.
+   Originator:	libffi  */
+
+/* { dg-do run } */
+#include "ffitest.h"
+
+typedef struct
+{
+  int n;
+  float v[4];
+} vec_t;
+
+static float
+vec_sum (vec_t v, int scale)
+{
+  return (v.v[0] + v.v[1] + v.v[2] + v.v[3]) * scale + v.n;
+}
+
+int main (void)
+{
+  ffi_cif cif;
+  void *values[2];
+  vec_t v = { 10, { 1.0f, 2.0f, 3.0f, 4.0f } };
+  int scale = 2;
+  float res;
+
+  CHECK(ffi_prep_cif_from_string (&cif, FFI_DEFAULT_ABI, "f({i[4f]}i)")
+	== FFI_OK);
+  CHECK(cif.arg_types[0]->size == sizeof (vec_t));
+
+  values[0] = &v;
+  values[1] = &scale;
+  ffi_call (&cif, FFI_FN(vec_sum), &res, values);
+  printf ("vec_sum: %g\n", res);
+  CHECK(res == 30.0f);
+
+  CHECK(ffi_prep_cif_from_string (&cif, FFI_DEFAULT_ABI, "i({[0i]})")
+	!= FFI_OK);
+  CHECK(ffi_prep_cif_from_string (&cif, FFI_DEFAULT_ABI, "i({[4]})")
+	!= FFI_OK);
+
+  exit(0);
+}
@@ -0,0 +1 @@
+#include "../libffi.call/ffitest.h"
@@ -0,0 +1,181 @@
+/* Area:	ffi_cif_export, ffi_cif_import, ffi_call
+   Purpose:	Check that exported cifs can be loaded and called.
+   Limitations:	none.
+   PR:		none.
+   Originator:	libffi  */
+
+/* { dg-do run } */
+#include "ffitest.h"
+
+typedef struct
+{
+  char c;
+  double d;
+} inner_t;
+
+typedef struct
+{
+  short s;
+  inner_t in;
+  int i;
+} outer_t;
+
+typedef struct
+{
+  long a, b, c, d;
+} big_t;
+
+static int
+outer_fn (outer_t o, int k)
+{
+  return o.s + o.in.c + (int) o.in.d + o.i + k;
+}
+
+static big_t
+big_fn (long x)
+{
+  big_t r = { x, x + 1, x + 2, x + 3 };
+  return r;
+}
+
+static double
+sum_fn (float f, double d, long long ll)
+{
+  return f + d + (double) ll;
+}
+
+static int
+seven (void)
+{
+  return 7;
+}
+
+int main (void)
+{
+  ffi_type inner, outer, big;
+  ffi_type *inner_elts[3], *outer_elts[4], *big_elts[5];
+  ffi_type *outer_args[2], *big_args[1], *sum_args[3];
+  ffi_cif cif_outer, cif_big, cif_sum, cif_seven;
+  ffi_cif *list[4];
+  ffi_cif *loaded;
+  size_t n, size, i;
+  unsigned char *blob;
+  void *values[3];
+  ffi_arg res;
+
+  outer_t o = { 1, { 2, 3.0 }, 4 };
+  int k = 5;
+  long x = 10;
+  float f = 1.5f;
+  double d = 2.25;
+  long long ll = 3;
+  big_t bres;
+  double dres;
+
+  inner.size = inner.alignment = 0;
+  inner.type = FFI_TYPE_STRUCT;
+  inner.elements = inner_elts;
+  inner_elts[0] = &ffi_type_schar;
+  inner_elts[1] = &ffi_type_double;
+  inner_elts[2] = NULL;
+
+  outer.size = outer.alignment = 0;
+  outer.type = FFI_TYPE_STRUCT;
+  outer.elements = outer_elts;
+  outer_elts[0] = &ffi_type_sshort;
+  outer_elts[1] = &inner;
+  outer_elts[2] = &ffi_type_sint;
+  outer_elts[3] = NULL;
+
+  big.size = big.alignment = 0;
+  big.type = FFI_TYPE_STRUCT;
+  big.elements = big_elts;
+  for (i = 0; i < 4; i++)
+    big_elts[i] = &ffi_type_slong;
+  big_elts[4] = NULL;
+
+  outer_args[0] = &outer;
+  outer_args[1] = &ffi_type_sint;
+  big_args[0] = &ffi_type_slong;
+  sum_args[0] = &ffi_type_float;
+  sum_args[1] = &ffi_type_double;
+  sum_args[2] = &ffi_type_sint64;
+
+  CHECK(ffi_prep_cif (&cif_outer, FFI_DEFAULT_ABI, 2, &ffi_type_sint,
+		      outer_args) == FFI_OK);
+  CHECK(ffi_prep_cif (&cif_big, FFI_DEFAULT_ABI, 1, &big, big_args)
+	== FFI_OK);
+  CHECK(ffi_prep_cif (&cif_sum, FFI_DEFAULT_ABI, 3, &ffi_type_double,
+		      sum_args) == FFI_OK);
+  CHECK(ffi_prep_cif (&cif_seven, FFI_DEFAULT_ABI, 0, &ffi_type_sint,
+		      NULL) == FFI_OK);
+
+  list[0] = &cif_outer;
+  list[1] = &cif_big;
+  list[2] = &cif_sum;
+  list[3] = &cif_seven;
+
+  size = ffi_cif_export (list, 4, NULL, 0);
+  CHECK(size > 0);
+  blob = malloc (size);
+  CHECK(blob != NULL);
+  CHECK(ffi_cif_export (list, 4, blob, size - 1) == size);
+  CHECK(ffi_cif_export (list, 4, blob, size) == size);
+
+  CHECK(ffi_cif_import (blob, size, &loaded, &n) == FFI_OK);
+  CHECK(n == 4);
+  for (i = 0; i < n; i++)
+    {
+      CHECK(loaded[i].abi == list[i]->abi);
+      CHECK(loaded[i].nargs == list[i]->nargs);
+      CHECK(loaded[i].bytes == list[i]->bytes);
+      CHECK(loaded[i].flags == list[i]->flags);
+      CHECK(loaded[i].rtype->size == list[i]->rtype->size);
+    }
+  /* Primitive types are shared, everything else is a copy.  */
+  CHECK(loaded[0].arg_types[1] == &ffi_type_sint);
+  CHECK(loaded[0].arg_types[0] != &outer);
+  CHECK(loaded[0].arg_types[0]->size == sizeof (outer_t));
+  CHECK(loaded[0].arg_types[0]->elements[1]->size == sizeof (inner_t));
+  CHECK(loaded[0].arg_types[0]->elements[3] == NULL);
+
+  values[0] = &o;
+  values[1] = &k;
+  ffi_call (&loaded[0], FFI_FN(outer_fn), &res, values);
+  printf ("outer_fn: %d\n", (int) res);
+  CHECK((int) res == 15);
+
+  values[0] = &x;
+  ffi_call (&loaded[1], FFI_FN(big_fn), &bres, values);
+  CHECK(bres.a == 10 && bres.b == 11 && bres.c == 12 && bres.d == 13);
+
+  values[0] = &f;
+  values[1] = &d;
+  values[2] = &ll;
+  ffi_call (&loaded[2], FFI_FN(sum_fn), &dres, values);
+  printf ("sum_fn: %g\n", dres);
+  CHECK(dres == 6.75);
+
+  ffi_call (&loaded[3], FFI_FN(seven), &res, NULL);
+  CHECK((int) res == 7);
+
+  ffi_cif_import_free (loaded);
+
+  /* Truncated and damaged blobs are refused.  */
+  CHECK(ffi_cif_import (blob, size - 4, &loaded, &n) == FFI_BAD_TYPEDEF);
+  blob[size - 1] ^= 1;
+  CHECK(ffi_cif_import (blob, size, &loaded, &n) == FFI_BAD_TYPEDEF);
+  blob[size - 1] ^= 1;
+  blob[0] ^= 1;
+  CHECK(ffi_cif_import (blob, size, &loaded, &n) == FFI_BAD_TYPEDEF);
+  blob[0] ^= 1;
+  CHECK(ffi_cif_import (blob, size, &loaded, &n) == FFI_OK);
+  ffi_cif_import_free (loaded);
+
+  /* An unprepared cif cannot be exported.  */
+  memset (&cif_seven, 0, sizeof (cif_seven));
+  CHECK(ffi_cif_export (list, 4, NULL, 0) == 0);
+
+  free (blob);
+  exit(0);
+}
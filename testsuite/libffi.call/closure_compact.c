@@ -0,0 +1,115 @@
+/* Area:	closure_call
+   Purpose:	Check that compact closures sharing a descriptor each
+		call its function with their own user data.
+   Limitations:	Only targets with compact closures.
+   PR:		none.
+   Originator:	libffi  */
+
+/* { dg-do run } */
+#include "ffitest.h"
+
+#ifdef FFI_TARGET_HAS_COMPACT_CLOSURE
+
+#define COUNT 1000
+
+struct big
+{
+  long a, b, c, d;
+};
+
+static void
+scale_fn (ffi_cif *cif __UNUSED__, void *resp, void **args, void *userdata)
+{
+  *(double *) resp = *(int *) args[0] * *(double *) userdata
+		     + *(double *) args[1];
+}
+
+static void
+big_fn (ffi_cif *cif __UNUSED__, void *resp, void **args, void *userdata)
+{
+  struct big *r = resp;
+  long x = *(long *) args[0] + (long) (intptr_t) userdata;
+
+  r->a = x;
+  r->b = x + 1;
+  r->c = x + 2;
+  r->d = x + 3;
+}
+
+typedef double (*scale_fn_t) (int, double);
+typedef struct big (*big_fn_t) (long);
+
+int main (void)
+{
+  ffi_type *scale_args[2], *big_args[1];
+  ffi_type big_type, *big_elts[5];
+  ffi_cif scale_cif, big_cif, bad_cif;
+  ffi_closure_desc scale_desc, big_desc, empty_desc = { NULL, NULL, NULL };
+  ffi_compact_closure *cl, *bcl;
+  void *code, *bcode;
+  double scales[COUNT];
+  struct big r;
+  int i;
+
+  scale_args[0] = &ffi_type_sint;
+  scale_args[1] = &ffi_type_double;
+  CHECK(ffi_prep_cif (&scale_cif, FFI_DEFAULT_ABI, 2, &ffi_type_double,
+		      scale_args) == FFI_OK);
+  CHECK(ffi_prep_closure_desc (&scale_desc, &scale_cif, scale_fn) == FFI_OK);
+
+  big_type.size = big_type.alignment = 0;
+  big_type.type = FFI_TYPE_STRUCT;
+  big_type.elements = big_elts;
+  for (i = 0; i < 4; i++)
+    big_elts[i] = &ffi_type_slong;
+  big_elts[4] = NULL;
+  big_args[0] = &ffi_type_slong;
+  CHECK(ffi_prep_cif (&big_cif, FFI_DEFAULT_ABI, 1, &big_type, big_args)
+	== FFI_OK);
+  CHECK(ffi_prep_closure_desc (&big_desc, &big_cif, big_fn) == FFI_OK);
+
+#ifdef __x86_64__
+  CHECK(ffi_prep_cif (&bad_cif, FFI_WIN64, 0, &ffi_type_void, NULL)
+	== FFI_OK);
+  CHECK(ffi_prep_closure_desc (&big_desc, &bad_cif, big_fn) == FFI_BAD_ABI);
+#endif
+
+  /* Many compact closures fit in one allocation.  */
+  cl = ffi_closure_alloc (COUNT * sizeof (*cl), &code);
+  CHECK(cl != NULL);
+  CHECK(ffi_prep_compact_closure_loc (&cl[0], &empty_desc, NULL, code)
+	== FFI_BAD_TYPEDEF);
+  for (i = 0; i < COUNT; i++)
+    {
+      scales[i] = i * 0.5;
+      CHECK(ffi_prep_compact_closure_loc (&cl[i], &scale_desc, &scales[i],
+					  (ffi_compact_closure *) code + i)
+	    == FFI_OK);
+    }
+  for (i = 0; i < COUNT; i++)
+    {
+      scale_fn_t f = (scale_fn_t) ((ffi_compact_closure *) code + i);
+
+      CHECK(f (4, 0.25) == i * 2 + 0.25);
+    }
+
+  bcl = ffi_closure_alloc (sizeof (*bcl), &bcode);
+  CHECK(bcl != NULL);
+  CHECK(ffi_prep_compact_closure_loc (bcl, &big_desc, (void *) 100, bcode)
+	== FFI_OK);
+  r = ((big_fn_t) bcode) (5);
+  CHECK(r.a == 105 && r.b == 106 && r.c == 107 && r.d == 108);
+
+  ffi_closure_free (bcl);
+  ffi_closure_free (cl);
+  exit(0);
+}
+
+#else
+
+int main (void)
+{
+  exit(0);
+}
+
+#endif
@@ -0,0 +1,64 @@
+/* Area:	closure_call
+   Purpose:	Check that closures work whichever way executable memory
+		is mapped.
+   Limitations:	none.
+   PR:		none.
+   Originator:	libffi  */
+
+/* { dg-do run } */
+#include "ffitest.h"
+
+static void
+add_fn (ffi_cif *cif __UNUSED__, void *resp, void **args,
+	void *userdata)
+{
+  *(ffi_arg *) resp = *(int *) args[0] + (int) (intptr_t) userdata;
+}
+
+typedef int (*add_fn_t) (int);
+
+/* Returns nonzero if the closure was mapped at two addresses.  */
+static int
+check_closure (ffi_cif *cif, int n)
+{
+  ffi_closure *pcl;
+  void *code;
+
+  pcl = ffi_closure_alloc (sizeof (ffi_closure), &code);
+  CHECK(pcl != NULL);
+  CHECK(ffi_prep_closure_loc (pcl, cif, add_fn, (void *) (intptr_t) n,
+			      code) == FFI_OK);
+  CHECK(((add_fn_t) code) (5) == n + 5);
+  ffi_closure_free (pcl);
+  return code != (void *) pcl;
+}
+
+int main (void)
+{
+  ffi_type *args[1];
+  ffi_cif cif;
+  int split;
+
+  args[0] = &ffi_type_sint;
+  CHECK(ffi_prep_cif (&cif, FFI_DEFAULT_ABI, 1, &ffi_type_sint, args)
+	== FFI_OK);
+
+  /* Set before the first allocation, so that it decides how the
+     closure heap is mapped.  */
+  CHECK(ffi_closure_exec_mode (FFI_EXEC_SPLIT) == FFI_EXEC_PROBE);
+  split = check_closure (&cif, 1);
+#if defined __linux__ && !defined __ANDROID__
+  /* closures.c maps split views here; the writable and executable
+     ones are at different addresses.  */
+  CHECK(split);
+#endif
+
+  /* Out of range values are ignored.  */
+  CHECK(ffi_closure_exec_mode ((ffi_exec_mode) 42) == FFI_EXEC_SPLIT);
+  CHECK(ffi_closure_exec_mode (FFI_EXEC_DIRECT) == FFI_EXEC_SPLIT);
+  check_closure (&cif, 2);
+
+  CHECK(ffi_closure_exec_mode (FFI_EXEC_PROBE) == FFI_EXEC_DIRECT);
+  check_closure (&cif, 3);
+  exit(0);
+}
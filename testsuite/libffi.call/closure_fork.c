@@ -0,0 +1,93 @@
+/* Area:	closure_call
+   Purpose:	Check that closures allocated or prepared in a child
+		process are not seen by its parent.
+   Limitations:	Only systems with fork.
+   PR:		none.
+   Originator:	libffi  */
+
+/* { dg-do run } */
+#include "ffitest.h"
+
+#if defined __unix__ || defined __APPLE__
+#include <unistd.h>
+#include <sys/wait.h>
+
+static void
+add_fn (ffi_cif *cif __UNUSED__, void *resp, void **args,
+	void *userdata)
+{
+  *(ffi_arg *) resp = *(int *) args[0] + (int) (intptr_t) userdata;
+}
+
+typedef int (*add_fn_t) (int);
+
+static ffi_closure *
+make_closure (ffi_cif *cif, int n, void **code)
+{
+  ffi_closure *pcl = ffi_closure_alloc (sizeof (ffi_closure), code);
+
+  CHECK(pcl != NULL);
+  CHECK(ffi_prep_closure_loc (pcl, cif, add_fn, (void *) (intptr_t) n,
+			      *code) == FFI_OK);
+  return pcl;
+}
+
+int main (void)
+{
+  ffi_type *args[1];
+  ffi_cif cif;
+  ffi_closure *a, *b, *c;
+  void *a_code, *b_code, *c_code;
+  pid_t pid;
+  int status;
+
+  args[0] = &ffi_type_sint;
+  CHECK(ffi_prep_cif (&cif, FFI_DEFAULT_ABI, 1, &ffi_type_sint, args)
+	== FFI_OK);
+
+  /* Use separate mappings where they exist, since those are the ones
+     a child shares.  */
+  ffi_closure_exec_mode (FFI_EXEC_SPLIT);
+  CHECK(ffi_closure_reserve (64 * 1024) == 0);
+  a = make_closure (&cif, 1, &a_code);
+
+  pid = fork ();
+  CHECK(pid != -1);
+  if (pid == 0)
+    {
+      /* The inherited closure still works, and both preparing it
+	 again and allocating new ones stay in the child.  */
+      if (((add_fn_t) a_code) (10) != 11)
+	_exit (1);
+      b = make_closure (&cif, 2, &b_code);
+      if (((add_fn_t) b_code) (10) != 12)
+	_exit (2);
+      ffi_closure_free (b);
+      CHECK(ffi_prep_closure_loc (a, &cif, add_fn, (void *) 100, a_code)
+	    == FFI_OK);
+      if (((add_fn_t) a_code) (10) != 110)
+	_exit (3);
+      _exit (0);
+    }
+
+  CHECK(waitpid (pid, &status, 0) == pid);
+  CHECK(WIFEXITED (status) && WEXITSTATUS (status) == 0);
+
+  /* The child allocated B from memory the parent also sees as free.  */
+  c = make_closure (&cif, 3, &c_code);
+  CHECK(((add_fn_t) a_code) (10) == 11);
+  CHECK(((add_fn_t) c_code) (10) == 13);
+
+  ffi_closure_free (a);
+  ffi_closure_free (c);
+  exit(0);
+}
+
+#else
+
+int main (void)
+{
+  exit(0);
+}
+
+#endif
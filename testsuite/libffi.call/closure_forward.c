@@ -0,0 +1,190 @@
+/* Area:	closure_call
+   Purpose:	Check that forwarding closures pass their arguments on
+		unchanged and return the target's result.
+   Limitations:	none.
+   PR:		none.
+   Originator:	libffi  */
+
+/* { dg-do run } */
+#include "ffitest.h"
+
+struct small
+{
+  int a;
+  double b;
+};
+
+struct big
+{
+  long a, b, c, d;
+};
+
+static int
+many_fn (int a, double b, signed char c, long d, float e, int f, int g,
+	 double h, double i, double j, double k, double l, double m,
+	 double n, long o, long p, struct small q)
+{
+  return a + (int) b + c + (int) d + (int) e + f + g + (int) (h + i + j + k
+	 + l + m + n) + (int) o + (int) p + q.a + (int) q.b;
+}
+
+static struct big
+big_fn (struct small s, long x)
+{
+  struct big r = { s.a, (long) s.b, x, x + 1 };
+  return r;
+}
+
+static float
+float_fn (float a, double b)
+{
+  return a * (float) b;
+}
+
+static int
+seven_fn (void)
+{
+  return 7;
+}
+
+struct counter
+{
+  void (*fn) (void);
+  int calls;
+};
+
+static void
+count_fn (ffi_cif *cif __UNUSED__, void *resp __UNUSED__, ffi_frame *frame,
+	  void *userdata)
+{
+  struct counter *c = userdata;
+
+  c->calls++;
+  ffi_frame_forward (frame, c->fn);
+}
+
+static void
+twice_fn (ffi_cif *cif __UNUSED__, void *resp, ffi_frame *frame,
+	  void *userdata)
+{
+  struct counter *c = userdata;
+
+  /* A frame can be forwarded more than once; the last result wins.  */
+  ffi_frame_forward (frame, c->fn);
+  ffi_frame_forward (frame, c->fn);
+  *(ffi_arg *) resp += 1000;
+  c->calls++;
+}
+
+typedef int (*many_fn_t) (int, double, signed char, long, float, int, int,
+			  double, double, double, double, double, double,
+			  double, long, long, struct small);
+typedef struct big (*big_fn_t) (struct small, long);
+typedef float (*float_fn_t) (float, double);
+typedef int (*seven_fn_t) (void);
+
+int main (void)
+{
+  ffi_type small_type, *small_elts[3];
+  ffi_type big_type, *big_elts[5];
+  ffi_type *many_args[17], *big_args[2], *float_args[2];
+  ffi_cif many_cif, big_cif, float_cif, seven_cif;
+  ffi_closure *pcl[5];
+  void *code[5];
+  struct counter many_c = { FFI_FN(many_fn), 0 };
+  struct counter big_c = { FFI_FN(big_fn), 0 };
+  struct counter float_c = { FFI_FN(float_fn), 0 };
+  struct counter seven_c = { FFI_FN(seven_fn), 0 };
+  ffi_forward_target many_t = { count_fn, &many_c };
+  ffi_forward_target big_t = { count_fn, &big_c };
+  ffi_forward_target float_t = { count_fn, &float_c };
+  ffi_forward_target seven_t = { count_fn, &seven_c };
+  ffi_forward_target twice_t = { twice_fn, &seven_c };
+  ffi_forward_target bad = { NULL, NULL };
+  struct small s = { 3, 4.0 };
+  struct big r;
+  int i;
+
+  small_type.size = small_type.alignment = 0;
+  small_type.type = FFI_TYPE_STRUCT;
+  small_type.elements = small_elts;
+  small_elts[0] = &ffi_type_sint;
+  small_elts[1] = &ffi_type_double;
+  small_elts[2] = NULL;
+
+  big_type.size = big_type.alignment = 0;
+  big_type.type = FFI_TYPE_STRUCT;
+  big_type.elements = big_elts;
+  for (i = 0; i < 4; i++)
+    big_elts[i] = &ffi_type_slong;
+  big_elts[4] = NULL;
+
+  many_args[0] = &ffi_type_sint;
+  many_args[1] = &ffi_type_double;
+  many_args[2] = &ffi_type_schar;
+  many_args[3] = &ffi_type_slong;
+  many_args[4] = &ffi_type_float;
+  many_args[5] = &ffi_type_sint;
+  many_args[6] = &ffi_type_sint;
+  for (i = 7; i < 14; i++)
+    many_args[i] = &ffi_type_double;
+  many_args[14] = &ffi_type_slong;
+  many_args[15] = &ffi_type_slong;
+  many_args[16] = &small_type;
+  CHECK(ffi_prep_cif (&many_cif, FFI_DEFAULT_ABI, 17, &ffi_type_sint,
+		      many_args) == FFI_OK);
+
+  big_args[0] = &small_type;
+  big_args[1] = &ffi_type_slong;
+  CHECK(ffi_prep_cif (&big_cif, FFI_DEFAULT_ABI, 2, &big_type, big_args)
+	== FFI_OK);
+
+  float_args[0] = &ffi_type_float;
+  float_args[1] = &ffi_type_double;
+  CHECK(ffi_prep_cif (&float_cif, FFI_DEFAULT_ABI, 2, &ffi_type_float,
+		      float_args) == FFI_OK);
+
+  CHECK(ffi_prep_cif (&seven_cif, FFI_DEFAULT_ABI, 0, &ffi_type_sint, NULL)
+	== FFI_OK);
+
+  for (i = 0; i < 5; i++)
+    {
+      pcl[i] = ffi_closure_alloc (sizeof (ffi_closure), &code[i]);
+      CHECK(pcl[i] != NULL);
+    }
+
+  CHECK(ffi_prep_forward_closure_loc (pcl[0], &many_cif, &bad, code[0])
+	== FFI_BAD_TYPEDEF);
+  CHECK(ffi_prep_forward_closure_loc (pcl[0], &many_cif, &many_t, code[0])
+	== FFI_OK);
+  CHECK(ffi_prep_forward_closure_loc (pcl[1], &big_cif, &big_t, code[1])
+	== FFI_OK);
+  CHECK(ffi_prep_forward_closure_loc (pcl[2], &float_cif, &float_t, code[2])
+	== FFI_OK);
+  CHECK(ffi_prep_forward_closure_loc (pcl[3], &seven_cif, &seven_t, code[3])
+	== FFI_OK);
+  CHECK(ffi_prep_forward_closure_loc (pcl[4], &seven_cif, &twice_t, code[4])
+	== FFI_OK);
+
+  i = ((many_fn_t) code[0]) (1, 2.5, -3, 4, 5.5f, 6, 7, 1, 2, 3, 4, 5, 6, 7,
+			     8, 9, s);
+  printf ("many: %d\n", i);
+  CHECK(i == many_fn (1, 2.5, -3, 4, 5.5f, 6, 7, 1, 2, 3, 4, 5, 6, 7,
+		      8, 9, s));
+
+  r = ((big_fn_t) code[1]) (s, 10);
+  CHECK(r.a == 3 && r.b == 4 && r.c == 10 && r.d == 11);
+
+  CHECK(((float_fn_t) code[2]) (1.5f, 3.0) == 4.5f);
+  CHECK(((seven_fn_t) code[3]) () == 7);
+  CHECK(((seven_fn_t) code[4]) () == 1007);
+
+  CHECK(many_c.calls == 1);
+  CHECK(big_c.calls == 1);
+  CHECK(float_c.calls == 1);
+  CHECK(seven_c.calls == 2);
+
+  for (i = 0; i < 5; i++)
+    ffi_closure_free (pcl[i]);
+  exit(0);
+}
@@ -0,0 +1,148 @@
+/* Area:	closure_call
+   Purpose:	Check that register-frame closures see the saved argument
+		registers and the stack arguments.
+   Limitations:	Only targets that provide ffi_regs.
+   PR:		none.
+   Originator:	libffi  */
+
+/* { dg-do run } */
+#include "ffitest.h"
+
+#ifdef FFI_TARGET_HAS_REGS_CLOSURE
+
+struct big
+{
+  long a, b, c, d;
+};
+
+/* (int, double, long, double) -> double: the integers go in the first
+   two integer registers, the doubles in the first two vector ones.  */
+static void
+mixed_fn (ffi_cif *cif __UNUSED__, void *resp, ffi_regs *regs,
+	  void *stack __UNUSED__, void *userdata)
+{
+  int a = (int) FFI_REGS_GPR (regs, 0);
+  double b = *(double *) FFI_REGS_VEC (regs, 0);
+  long c = (long) FFI_REGS_GPR (regs, 1);
+  double d = *(double *) FFI_REGS_VEC (regs, 1);
+
+  *(double *) resp = a + b + c + d + (double) (intptr_t) userdata;
+}
+
+/* FFI_REGS_NGPR + 2 longs -> long: the last two are on the stack.  */
+static void
+stack_fn (ffi_cif *cif __UNUSED__, void *resp, ffi_regs *regs, void *stack,
+	  void *userdata __UNUSED__)
+{
+  long sum = 0;
+  int i;
+
+  for (i = 0; i < FFI_REGS_NGPR; i++)
+    sum += (long) FFI_REGS_GPR (regs, i);
+  sum += ((long *) stack)[0] * 100 + ((long *) stack)[1] * 1000;
+  *(ffi_arg *) resp = sum;
+}
+
+/* (long) -> struct big, returned in memory.  */
+static void
+big_fn (ffi_cif *cif __UNUSED__, void *resp, ffi_regs *regs,
+	void *stack __UNUSED__, void *userdata __UNUSED__)
+{
+  struct big *r = resp;
+#ifdef __x86_64__
+  /* The address of the result is passed in the first register.  */
+  long x = (long) FFI_REGS_GPR (regs, 1);
+  CHECK((void *) FFI_REGS_GPR (regs, 0) == resp);
+#else
+  long x = (long) FFI_REGS_GPR (regs, 0);
+#endif
+
+  r->a = x;
+  r->b = x + 1;
+  r->c = x + 2;
+  r->d = x + 3;
+}
+
+typedef double (*mixed_fn_t) (int, double, long, double);
+typedef struct big (*big_fn_t) (long);
+
+int main (void)
+{
+  ffi_type *mixed_args[4], *stack_args[FFI_REGS_NGPR + 2], *big_args[1];
+  ffi_type big_type, *big_elts[5];
+  ffi_cif mixed_cif, stack_cif, big_cif;
+  ffi_closure *pcl[3];
+  void *code[3];
+  ffi_regs_target mixed_target = { mixed_fn, (void *) (intptr_t) 1000 };
+  ffi_regs_target stack_target = { stack_fn, NULL };
+  ffi_regs_target big_target = { big_fn, NULL };
+  ffi_regs_target bad = { NULL, NULL };
+  struct big r;
+  long sum;
+  int i;
+
+  mixed_args[0] = &ffi_type_sint;
+  mixed_args[1] = &ffi_type_double;
+  mixed_args[2] = &ffi_type_slong;
+  mixed_args[3] = &ffi_type_double;
+  CHECK(ffi_prep_cif (&mixed_cif, FFI_DEFAULT_ABI, 4, &ffi_type_double,
+		      mixed_args) == FFI_OK);
+
+  for (i = 0; i < FFI_REGS_NGPR + 2; i++)
+    stack_args[i] = &ffi_type_slong;
+  CHECK(ffi_prep_cif (&stack_cif, FFI_DEFAULT_ABI, FFI_REGS_NGPR + 2,
+		      &ffi_type_slong, stack_args) == FFI_OK);
+
+  big_type.size = big_type.alignment = 0;
+  big_type.type = FFI_TYPE_STRUCT;
+  big_type.elements = big_elts;
+  for (i = 0; i < 4; i++)
+    big_elts[i] = &ffi_type_slong;
+  big_elts[4] = NULL;
+  big_args[0] = &ffi_type_slong;
+  CHECK(ffi_prep_cif (&big_cif, FFI_DEFAULT_ABI, 1, &big_type, big_args)
+	== FFI_OK);
+
+  for (i = 0; i < 3; i++)
+    {
+      pcl[i] = ffi_closure_alloc (sizeof (ffi_closure), &code[i]);
+      CHECK(pcl[i] != NULL);
+    }
+
+  CHECK(ffi_prep_regs_closure_loc (pcl[0], &mixed_cif, &bad, code[0])
+	== FFI_BAD_TYPEDEF);
+  CHECK(ffi_prep_regs_closure_loc (pcl[0], &mixed_cif, &mixed_target,
+				   code[0]) == FFI_OK);
+  CHECK(ffi_prep_regs_closure_loc (pcl[1], &stack_cif, &stack_target,
+				   code[1]) == FFI_OK);
+  CHECK(ffi_prep_regs_closure_loc (pcl[2], &big_cif, &big_target,
+				   code[2]) == FFI_OK);
+
+  CHECK(((mixed_fn_t) code[0]) (1, 2.5, 3, 4.25) == 1010.75);
+
+#if defined (__x86_64__)
+  sum = ((long (*) (long, long, long, long, long, long, long, long))
+	 code[1]) (1, 2, 3, 4, 5, 6, 7, 8);
+  CHECK(sum == 21 + 700 + 8000);
+#else
+  sum = ((long (*) (long, long, long, long, long, long, long, long, long,
+		    long)) code[1]) (1, 2, 3, 4, 5, 6, 7, 8, 9, 10);
+  CHECK(sum == 36 + 900 + 10000);
+#endif
+
+  r = ((big_fn_t) code[2]) (10);
+  CHECK(r.a == 10 && r.b == 11 && r.c == 12 && r.d == 13);
+
+  for (i = 0; i < 3; i++)
+    ffi_closure_free (pcl[i]);
+  exit(0);
+}
+
+#else
+
+int main (void)
+{
+  exit(0);
+}
+
+#endif
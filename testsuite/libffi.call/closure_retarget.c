@@ -0,0 +1,70 @@
+/* Area:	closure_call
+   Purpose:	Check that a retargeted closure calls its new target.
+   Limitations:	none.
+   PR:		none.
+   Originator:	libffi  */
+
+/* { dg-do run } */
+#include "ffitest.h"
+
+static void
+add_fn (ffi_cif *cif __UNUSED__, void *resp, void **args, void *userdata)
+{
+  *(ffi_arg *) resp = *(int *) args[0] + (int) (intptr_t) userdata;
+}
+
+static void
+mul_fn (ffi_cif *cif __UNUSED__, void *resp, void **args, void *userdata)
+{
+  *(ffi_arg *) resp = *(int *) args[0] * (int) (intptr_t) userdata;
+}
+
+typedef int (*closure_retarget_type) (int);
+
+int main (void)
+{
+  ffi_cif cif;
+  ffi_type *cl_arg_types[1];
+  ffi_closure *pcl, *plain;
+  void *code, *plain_code;
+  ffi_closure_target add = { add_fn, (void *) (intptr_t) 10 };
+  ffi_closure_target mul = { mul_fn, (void *) (intptr_t) 3 };
+  ffi_closure_target bad = { NULL, NULL };
+
+  cl_arg_types[0] = &ffi_type_sint;
+  CHECK(ffi_prep_cif(&cif, FFI_DEFAULT_ABI, 1, &ffi_type_sint,
+		     cl_arg_types) == FFI_OK);
+
+  pcl = ffi_closure_alloc (sizeof (ffi_closure), &code);
+  CHECK(pcl != NULL);
+  CHECK(ffi_prep_retargetable_closure_loc (pcl, &cif, &bad, code)
+	== FFI_BAD_TYPEDEF);
+  CHECK(ffi_prep_retargetable_closure_loc (pcl, &cif, &add, code)
+	== FFI_OK);
+  CHECK(((closure_retarget_type) code) (5) == 15);
+
+  CHECK(ffi_closure_retarget (pcl, &mul) == &add);
+  CHECK(((closure_retarget_type) code) (6) == 18);
+  CHECK(((closure_retarget_type) code) (7) == 21);
+
+  /* The old target may be reused, or changed once it is no longer
+     current.  */
+  add.user_data = (void *) (intptr_t) 100;
+  CHECK(ffi_closure_retarget (pcl, &add) == &mul);
+  CHECK(((closure_retarget_type) code) (1) == 101);
+
+  CHECK(ffi_closure_retarget (pcl, &bad) == NULL);
+  CHECK(((closure_retarget_type) code) (1) == 101);
+
+  /* Only closures prepared as retargetable can be retargeted.  */
+  plain = ffi_closure_alloc (sizeof (ffi_closure), &plain_code);
+  CHECK(plain != NULL);
+  CHECK(ffi_prep_closure_loc (plain, &cif, add_fn, (void *) (intptr_t) 1,
+			      plain_code) == FFI_OK);
+  CHECK(ffi_closure_retarget (plain, &mul) == NULL);
+  CHECK(((closure_retarget_type) plain_code) (1) == 2);
+
+  ffi_closure_free (plain);
+  ffi_closure_free (pcl);
+  exit(0);
+}
@@ -0,0 +1,63 @@
+/* Area:	closure_call
+   Purpose:	Check closures prepared with deferred cache maintenance.
+   Limitations:	none.
+   PR:		none.
+   Originator:	libffi  */
+
+/* { dg-do run } */
+#include "ffitest.h"
+
+#define N_CLOSURES 200
+
+static void
+closure_sync_fn (ffi_cif *cif __UNUSED__, void *resp, void **args,
+		 void *userdata)
+{
+  *(ffi_arg *) resp = *(int *) args[0] + (int) (intptr_t) userdata;
+}
+
+typedef int (*closure_sync_type) (int);
+
+int main (void)
+{
+  ffi_cif cif;
+  ffi_type *cl_arg_types[1];
+  ffi_closure *pcl[N_CLOSURES];
+  void *code[N_CLOSURES];
+  int i;
+
+  cl_arg_types[0] = &ffi_type_sint;
+  CHECK(ffi_prep_cif(&cif, FFI_DEFAULT_ABI, 1, &ffi_type_sint,
+		     cl_arg_types) == FFI_OK);
+
+  CHECK(ffi_closure_defer_sync (1) == 0);
+  CHECK(ffi_closure_defer_sync (1) == 1);
+
+  for (i = 0; i < N_CLOSURES; i++)
+    {
+      pcl[i] = ffi_closure_alloc (sizeof (ffi_closure), &code[i]);
+      CHECK(pcl[i] != NULL);
+      CHECK(ffi_prep_closure_loc (pcl[i], &cif, closure_sync_fn,
+				  (void *) (intptr_t) i, code[i]) == FFI_OK);
+    }
+
+  ffi_closure_sync ();
+
+  for (i = 0; i < N_CLOSURES; i++)
+    CHECK(((closure_sync_type) code[i]) (1000) == 1000 + i);
+
+  /* Turning deferral off flushes whatever is still pending.  */
+  for (i = 0; i < N_CLOSURES; i++)
+    CHECK(ffi_prep_closure_loc (pcl[i], &cif, closure_sync_fn,
+				(void *) (intptr_t) (2 * i), code[i]) == FFI_OK);
+  CHECK(ffi_closure_defer_sync (0) == 1);
+
+  for (i = 0; i < N_CLOSURES; i++)
+    {
+      CHECK(((closure_sync_type) code[i]) (7) == 7 + 2 * i);
+      ffi_closure_free (pcl[i]);
+    }
+
+  printf ("closure sync ok\n");
+  exit(0);
+}
@@ -0,0 +1,93 @@
+/* Area:	ffi.hpp
+   Purpose:	Check cifs and calls derived from C++ types.
+   Limitations:	none.
+   PR:		none.
+   Originator:	libffi  */
+
+/* { dg-do run } */
+/* { dg-options "-std=c++17" } */
+
+#include "ffitest.h"
+#include <ffi.hpp>
+
+struct Inner
+{
+  char c;
+  double d;
+};
+
+struct Foo
+{
+  short s;
+  Inner in;
+  int v[3];
+};
+
+enum Colour : unsigned char { RED = 1, GREEN = 2 };
+
+template <> struct ffi::members<Inner> : ffi::member_list<char, double> {};
+template <> struct ffi::members<Foo>
+  : ffi::member_list<short, Inner, int[3]> {};
+
+static int
+foo_sum (double x, Foo f)
+{
+  return (int) x + f.s + f.in.c + (int) f.in.d + f.v[0] + f.v[1] + f.v[2];
+}
+
+static Foo
+foo_make (short s, Colour c, bool b)
+{
+  Foo f = { s, { (char) c, b ? 1.5 : 0.5 }, { 1, 2, 3 } };
+  return f;
+}
+
+static signed char
+narrow (signed char c, unsigned short u)
+{
+  return (signed char) (c - (int) u);
+}
+
+#if defined __x86_64__ && !defined _WIN32 && !defined __ILP32__
+static long long __MSABI__
+ms_add (int a, long long b, float c, double d, Inner e)
+{
+  return a + b + (long long) c + (long long) d + e.c;
+}
+#endif
+
+int main (void)
+{
+  Foo f = { 10, { 20, 30.0 }, { 1, 2, 3 } };
+
+  CHECK(ffi::type_of<int> () == &ffi_type_sint32);
+  CHECK(ffi::type_of<unsigned char> () == &ffi_type_uint8);
+  CHECK(ffi::type_of<Colour> () == &ffi_type_uint8);
+  CHECK(ffi::type_of<void *> () == &ffi_type_pointer);
+  CHECK(ffi::type_of<Foo> ()->size == sizeof (Foo));
+  CHECK(ffi::check_layout<Inner> ());
+  CHECK(ffi::check_layout<Foo> ());
+
+  ffi::function<int (double, Foo)> sum (foo_sum);
+  CHECK(sum.cif () != NULL);
+  CHECK(sum.cif ()->nargs == 2);
+  CHECK(sum (4.0, f) == 70);
+  CHECK(sum.call (4.0, f) == 70);
+
+  ffi::function<Foo (short, Colour, bool)> make (foo_make);
+  Foo g = make.call (7, GREEN, true);
+  printf ("make: %d %d %g %d\n", g.s, g.in.c, g.in.d, g.v[2]);
+  CHECK(g.s == 7 && g.in.c == GREEN && g.in.d == 1.5 && g.v[2] == 3);
+
+  ffi::function<signed char (signed char, unsigned short)> nar (narrow);
+  CHECK(nar.call (-3, 5) == -8);
+
+#if defined __x86_64__ && !defined _WIN32 && !defined __ILP32__
+  ffi::function<long long (int, long long, float, double, Inner),
+		FFI_WIN64> ms (ms_add);
+  Inner e = { 5, 0.0 };
+  CHECK(ms (1, 2, 3.0f, 4.0, e) == 15);
+#endif
+
+  exit(0);
+}
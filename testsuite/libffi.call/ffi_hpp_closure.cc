@@ -0,0 +1,86 @@
+/* Area:	ffi.hpp, closure_call
+   Purpose:	Check closures derived from C++ types.
+   Limitations:	none.
+   PR:		none.
+   Originator:	libffi  */
+
+/* { dg-do run } */
+/* { dg-options "-std=c++17" } */
+
+#include "ffitest.h"
+#include <ffi.hpp>
+
+struct Pair
+{
+  float a;
+  double b;
+};
+
+template <> struct ffi::members<Pair> : ffi::member_list<float, double> {};
+
+static int live;
+
+struct Counter
+{
+  int base;
+  int table[32];
+
+  explicit Counter (int b) : base (b)
+  {
+    for (int i = 0; i < 32; i++)
+      table[i] = i * i;
+    live++;
+  }
+  Counter (const Counter &o) : base (o.base)
+  {
+    for (int i = 0; i < 32; i++)
+      table[i] = o.table[i];
+    live++;
+  }
+  ~Counter () { live--; }
+
+  int operator() (int i, Pair p) const
+  {
+    return base + table[i] + (int) p.a + (int) p.b;
+  }
+};
+
+int main (void)
+{
+  {
+    ffi::closure<int (int, Pair)> c (Counter (100));
+    CHECK(c);
+    CHECK(live == 1);
+    CHECK(c.get () (3, Pair { 1.0f, 2.0 }) == 112);
+
+    ffi::closure<int (int, Pair)> d (std::move (c));
+    CHECK(!c && d);
+    CHECK(d.get () (5, Pair { 0.0f, 0.0 }) == 125);
+
+    /* Calling back through the typed call wrapper.  */
+    ffi::function<int (int, Pair)> f (d.get ());
+    CHECK(f.call (2, Pair { 1.0f, 1.0 }) == 106);
+  }
+  CHECK(live == 0);
+
+  int sum = 0;
+  ffi::closure<void (int)> add ([&sum] (int v) { sum += v; });
+  CHECK(add);
+  add.get () (4);
+  add.get () (5);
+  CHECK(sum == 9);
+
+  ffi::closure<signed char (unsigned short)> nar
+    ([] (unsigned short v) { return (signed char) -(int) v; });
+  CHECK(nar.get () (7) == -7);
+
+  ffi::closure<Pair (double)> mk ([] (double x) { return Pair { 1.5f, x }; });
+  Pair p = mk.get () (2.5);
+  printf ("mk: %g %g\n", p.a, p.b);
+  CHECK(p.a == 1.5f && p.b == 2.5);
+
+  add.reset ();
+  CHECK(!add);
+
+  exit(0);
+}
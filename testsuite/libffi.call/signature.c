@@ -0,0 +1,93 @@
+/* Area:	ffi_prep_cif_from_string, ffi_call
+   Purpose:	Check cifs prepared from signature strings.
+   Limitations:	none.
+   PR:		none.
+   Originator:	libffi  */
+
+/* { dg-do run } */
+#include "ffitest.h"
+
+typedef struct
+{
+  double a, b;
+} dd_t;
+
+typedef struct
+{
+  char c;
+  dd_t d;
+  short s;
+} nested_t;
+
+static int
+sig_fn (void *p, dd_t dd, int i)
+{
+  return (p != NULL) + (int) (dd.a * 10 + dd.b) + i;
+}
+
+static nested_t
+sig_nested (nested_t n, float f)
+{
+  n.c++;
+  n.d.a += f;
+  n.s--;
+  return n;
+}
+
+int main (void)
+{
+  ffi_cif cif, cif2;
+  void *values[3];
+  void *p = &cif;
+  dd_t dd = { 2.0, 3.0 };
+  int i = 100;
+  nested_t n = { 'a', { 1.0, 2.0 }, 7 }, nres;
+  float f = 0.5f;
+  ffi_arg res;
+
+  CHECK(ffi_prep_cif_from_string (&cif, FFI_DEFAULT_ABI, "i(p{dd}i)")
+	== FFI_OK);
+  CHECK(cif.nargs == 3);
+  CHECK(cif.rtype == &ffi_type_sint);
+  CHECK(cif.arg_types[0] == &ffi_type_pointer);
+  CHECK(cif.arg_types[1]->type == FFI_TYPE_STRUCT);
+  CHECK(cif.arg_types[1]->size == sizeof (dd_t));
+
+  values[0] = &p;
+  values[1] = &dd;
+  values[2] = &i;
+  ffi_call (&cif, FFI_FN(sig_fn), &res, values);
+  printf ("sig_fn: %d\n", (int) res);
+  CHECK((int) res == 124);
+
+  /* The second request is served from the cache.  */
+  CHECK(ffi_prep_cif_from_string (&cif2, FFI_DEFAULT_ABI, "i(p{dd}i)")
+	== FFI_OK);
+  CHECK(cif2.arg_types == cif.arg_types);
+
+  CHECK(ffi_prep_cif_from_string (&cif, FFI_DEFAULT_ABI,
+				  "{c{dd}s}({c{dd}s}f)") == FFI_OK);
+  CHECK(cif.rtype->size == sizeof (nested_t));
+  values[0] = &n;
+  values[1] = &f;
+  ffi_call (&cif, FFI_FN(sig_nested), &nres, values);
+  printf ("sig_nested: %c %g %g %d\n", nres.c, nres.d.a, nres.d.b, nres.s);
+  CHECK(nres.c == 'b' && nres.d.a == 1.5 && nres.d.b == 2.0 && nres.s == 6);
+
+  CHECK(ffi_prep_cif_from_string (&cif, FFI_DEFAULT_ABI, "v()") == FFI_OK);
+  CHECK(cif.nargs == 0 && cif.rtype == &ffi_type_void);
+
+  /* Malformed signatures.  */
+  CHECK(ffi_prep_cif_from_string (&cif, FFI_DEFAULT_ABI, "") != FFI_OK);
+  CHECK(ffi_prep_cif_from_string (&cif, FFI_DEFAULT_ABI, "i") != FFI_OK);
+  CHECK(ffi_prep_cif_from_string (&cif, FFI_DEFAULT_ABI, "i(") != FFI_OK);
+  CHECK(ffi_prep_cif_from_string (&cif, FFI_DEFAULT_ABI, "i(v)") != FFI_OK);
+  CHECK(ffi_prep_cif_from_string (&cif, FFI_DEFAULT_ABI, "i(x)") != FFI_OK);
+  CHECK(ffi_prep_cif_from_string (&cif, FFI_DEFAULT_ABI, "i({})") != FFI_OK);
+  CHECK(ffi_prep_cif_from_string (&cif, FFI_DEFAULT_ABI, "i({d)") != FFI_OK);
+  CHECK(ffi_prep_cif_from_string (&cif, FFI_DEFAULT_ABI, "i({v})") != FFI_OK);
+  CHECK(ffi_prep_cif_from_string (&cif, FFI_DEFAULT_ABI, "i(i)x") != FFI_OK);
+  CHECK(ffi_prep_cif_from_string (&cif, FFI_DEFAULT_ABI, "i([2i])") != FFI_OK);
+
+  exit(0);
+}
@@ -0,0 +1,83 @@
+/* Area:	ffi_stats_enable, ffi_stats_top
+   Purpose:	Check per-cif call statistics.
+   Limitations:	none.
+   PR:		none.
+   Originator:	libffi  */
+
+/* { dg-do run } */
+#include "ffitest.h"
+
+static int
+add_one (int x)
+{
+  return x + 1;
+}
+
+static void
+closure_fn (ffi_cif *cif __UNUSED__, void *resp, void **args,
+	    void *userdata __UNUSED__)
+{
+  *(ffi_arg *)resp = *(int *)args[0] * 2;
+}
+
+int main (void)
+{
+  ffi_cif hot, cold;
+  ffi_type *args[1];
+  void *values[1];
+  ffi_stats stats[4];
+  ffi_arg rint;
+  int arg, i;
+  void *code;
+  ffi_closure *pcl;
+
+  args[0] = &ffi_type_sint;
+  values[0] = &arg;
+  CHECK(ffi_prep_cif(&hot, FFI_DEFAULT_ABI, 1, &ffi_type_sint, args) == FFI_OK);
+  CHECK(ffi_prep_cif(&cold, FFI_DEFAULT_ABI, 1, &ffi_type_sint, args) == FFI_OK);
+
+  if (ffi_stats_enable (1) < 0)
+    {
+      /* Not built with --enable-stats; the API must be inert.  */
+      CHECK(ffi_stats_top (stats, 4, FFI_STATS_BY_CALLS) == 0);
+      exit (0);
+    }
+  ffi_stats_reset ();
+
+  for (i = 0; i < 3; i++)
+    {
+      arg = i;
+      ffi_call(&hot, FFI_FN(add_one), &rint, values);
+      CHECK((int)rint == i + 1);
+    }
+  arg = 10;
+  ffi_call(&cold, FFI_FN(add_one), &rint, values);
+  CHECK((int)rint == 11);
+
+  pcl = ffi_closure_alloc(sizeof(ffi_closure), &code);
+  CHECK(pcl != NULL);
+  CHECK(ffi_prep_closure_loc(pcl, &cold, closure_fn, NULL, code) == FFI_OK);
+  CHECK(((int (*)(int))code)(21) == 42);
+  ffi_closure_free(pcl);
+
+  CHECK(ffi_stats_enable (0) == 1);
+
+  /* Nothing is counted while collection is off.  */
+  ffi_call(&hot, FFI_FN(add_one), &rint, values);
+
+  CHECK(ffi_stats_top (stats, 4, FFI_STATS_BY_CALLS) == 2);
+  CHECK(stats[0].cif == &hot);
+  CHECK(stats[0].calls == 3);
+  CHECK(stats[0].closure_calls == 0);
+  CHECK(stats[1].cif == &cold);
+  CHECK(stats[1].calls == 1);
+  CHECK(stats[1].closure_calls == 1);
+
+  CHECK(ffi_stats_top (stats, 1, FFI_STATS_BY_CALLS) == 1);
+  CHECK(stats[0].cif == &hot);
+
+  ffi_stats_reset ();
+  CHECK(ffi_stats_top (stats, 4, FFI_STATS_BY_TICKS) == 0);
+
+  exit (0);
+}
@@ -0,0 +1,93 @@
+/* Area:	closure_call
+   Purpose:	Check that every entry of a thunk table calls the shared
+		function with its own user data.
+   Limitations:	none.
+   PR:		none.
+   Originator:	libffi  */
+
+/* { dg-do run } */
+#include "ffitest.h"
+
+#define COUNT 10000
+
+struct object
+{
+  int id;
+  double scale;
+};
+
+static void
+method_fn (ffi_cif *cif __UNUSED__, void *resp, void **args, void *userdata)
+{
+  struct object *obj = userdata;
+
+  *(double *) resp = obj->id + *(int *) args[0] * obj->scale
+		     + *(double *) args[1];
+}
+
+static void
+id_fn (ffi_cif *cif __UNUSED__, void *resp, void **args __UNUSED__,
+       void *userdata)
+{
+  *(ffi_arg *) resp = ((struct object *) userdata)->id;
+}
+
+typedef double (*method_fn_t) (int, double);
+typedef int (*id_fn_t) (void);
+
+int main (void)
+{
+  ffi_type *args[2];
+  ffi_cif cif, id_cif;
+  ffi_thunk_table *table, *id_table;
+  struct object *objs;
+  void **user_data;
+  int i;
+
+  args[0] = &ffi_type_sint;
+  args[1] = &ffi_type_double;
+  CHECK(ffi_prep_cif (&cif, FFI_DEFAULT_ABI, 2, &ffi_type_double, args)
+	== FFI_OK);
+  CHECK(ffi_prep_cif (&id_cif, FFI_DEFAULT_ABI, 0, &ffi_type_sint, NULL)
+	== FFI_OK);
+
+  CHECK(ffi_thunk_table_alloc (&cif, method_fn, 0) == NULL);
+  CHECK(ffi_thunk_table_alloc (&cif, NULL, 1) == NULL);
+
+  objs = malloc (COUNT * sizeof (*objs));
+  CHECK(objs != NULL);
+  table = ffi_thunk_table_alloc (&cif, method_fn, COUNT);
+  CHECK(table != NULL);
+  id_table = ffi_thunk_table_alloc (&id_cif, id_fn, COUNT);
+  CHECK(id_table != NULL);
+  CHECK(ffi_thunk_table_entry (table, COUNT) == NULL);
+
+  user_data = ffi_thunk_table_user_data (table);
+  for (i = 0; i < COUNT; i++)
+    {
+      objs[i].id = i;
+      objs[i].scale = 0.5;
+      user_data[i] = &objs[i];
+      ffi_thunk_table_user_data (id_table)[i] = &objs[COUNT - 1 - i];
+    }
+
+  for (i = 0; i < COUNT; i++)
+    {
+      method_fn_t m = (method_fn_t) ffi_thunk_table_entry (table, i);
+      id_fn_t f = (id_fn_t) ffi_thunk_table_entry (id_table, i);
+
+      CHECK(m (4, 0.25) == i + 2.25);
+      CHECK(f () == COUNT - 1 - i);
+    }
+
+  /* User data can be changed after the table is built.  */
+  objs[7].scale = 2;
+  user_data[8] = &objs[7];
+  CHECK(((method_fn_t) ffi_thunk_table_entry (table, 8)) (3, 1) == 14);
+
+  ffi_thunk_table_free (table);
+  ffi_thunk_table_free (id_table);
+  ffi_thunk_table_free (NULL);
+  free (objs);
+  exit(0);
+}
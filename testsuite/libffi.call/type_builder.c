@@ -0,0 +1,88 @@
+/* Area:	ffi_type_builder, ffi_call
+   Purpose:	Check structure types built in an arena.
+   Limitations:	none.
+   PR:		none.
+   Originator:	libffi  */
+
+/* { dg-do run } */
+#include "ffitest.h"
+#include <stddef.h>
+
+typedef struct
+{
+  char c;
+  double d;
+} inner_t;
+
+typedef struct
+{
+  short s;
+  inner_t in;
+  int i;
+} outer_t;
+
+static int
+outer_fn (outer_t o, int k)
+{
+  return o.s + o.in.c + (int) o.in.d + o.i + k;
+}
+
+int main (void)
+{
+  ffi_type_builder *b;
+  ffi_type *inner, *outer, *elts[3], *args[2];
+  size_t offsets[3];
+  ffi_cif cif;
+  void *values[2];
+  outer_t o = { 1, { 2, 3.0 }, 4 };
+  int k = 5;
+  ffi_arg res;
+  int i;
+
+  CHECK(ffi_type_builder_new (FFI_LAST_ABI, 0) == NULL);
+
+  b = ffi_type_builder_new (FFI_DEFAULT_ABI, 0);
+  CHECK(b != NULL);
+
+  elts[0] = &ffi_type_schar;
+  elts[1] = &ffi_type_double;
+  inner = ffi_type_builder_struct (b, 2, elts, NULL);
+  CHECK(inner != NULL);
+  CHECK(inner->size == sizeof (inner_t));
+  CHECK(inner->alignment == offsetof (struct { char c; inner_t t; }, t));
+  CHECK(inner->elements[2] == NULL);
+
+  elts[0] = &ffi_type_sshort;
+  elts[1] = inner;
+  elts[2] = &ffi_type_sint;
+  outer = ffi_type_builder_struct (b, 3, elts, offsets);
+  CHECK(outer != NULL);
+  CHECK(outer->size == sizeof (outer_t));
+  CHECK(offsets[0] == offsetof (outer_t, s));
+  CHECK(offsets[1] == offsetof (outer_t, in));
+  CHECK(offsets[2] == offsetof (outer_t, i));
+
+  CHECK(ffi_type_builder_struct (b, 0, elts, NULL) == NULL);
+
+  args[0] = outer;
+  args[1] = &ffi_type_sint;
+  CHECK(ffi_prep_cif (&cif, FFI_DEFAULT_ABI, 2, &ffi_type_sint, args)
+	== FFI_OK);
+  values[0] = &o;
+  values[1] = &k;
+  ffi_call (&cif, FFI_FN(outer_fn), &res, values);
+  printf ("outer_fn: %d\n", (int) res);
+  CHECK((int) res == 15);
+
+  /* Enough types to need more than one block.  */
+  for (i = 0; i < 1000; i++)
+    CHECK(ffi_type_builder_struct (b, 3, elts, NULL) != NULL);
+
+  ffi_type_builder_free (b);
+
+  b = ffi_type_builder_new (FFI_DEFAULT_ABI, 1 << 16);
+  CHECK(b != NULL);
+  ffi_type_builder_free (b);
+
+  exit(0);
+}
@@ -0,0 +1,132 @@
+/* Area:	ffi_prep_var_template, ffi_prep_cif_var_tail, ffi_call
+   Purpose:	Check variadic calls prepared from a template.
+   Limitations:	none.
+   PR:		none.
+   Originator:	libffi  */
+
+/* { dg-do run } */
+/* { dg-output "" { xfail avr32*-*-* } } */
+
+#include "ffitest.h"
+#include <stdarg.h>
+
+struct pair
+{
+  int a;
+  int b;
+};
+
+/* Sum the arguments described by FMT: 'i' for int, 'd' for double, 'l'
+   for long and 'p' for struct pair.  */
+static double
+sum_fn (const char *fmt, ...)
+{
+  va_list ap;
+  double sum = 0;
+  struct pair p;
+
+  va_start (ap, fmt);
+  for (; *fmt; fmt++)
+    switch (*fmt)
+      {
+      case 'i': sum += va_arg (ap, int); break;
+      case 'd': sum += va_arg (ap, double); break;
+      case 'l': sum += va_arg (ap, long); break;
+      case 'p':
+	p = va_arg (ap, struct pair);
+	sum += p.a + p.b;
+	break;
+      }
+  va_end (ap);
+  return sum;
+}
+
+int main (void)
+{
+  ffi_type pair_type, *pair_elts[3];
+  ffi_type *fixed[1], *atypes[32];
+  ffi_var_template tmpl;
+  ffi_cif cif, ref;
+  void *values[32];
+  const char *fmts[] = { "", "i", "dd", "ipdl", "dddddddddd",
+			 "iiiiiiiidpp", "pppppplll" };
+  const char *fmt;
+  int ints[32];
+  double doubles[32];
+  long longs[32];
+  struct pair pairs[32];
+  double res, expect;
+  unsigned i, j, n;
+
+  pair_type.size = pair_type.alignment = 0;
+  pair_type.type = FFI_TYPE_STRUCT;
+  pair_type.elements = pair_elts;
+  pair_elts[0] = &ffi_type_sint;
+  pair_elts[1] = &ffi_type_sint;
+  pair_elts[2] = NULL;
+
+  fixed[0] = &ffi_type_pointer;
+  CHECK(ffi_prep_var_template (&tmpl, FFI_DEFAULT_ABI, 0, &ffi_type_double,
+			       fixed) == FFI_BAD_TYPEDEF);
+  CHECK(ffi_prep_var_template (&tmpl, FFI_DEFAULT_ABI, 1, &ffi_type_double,
+			       fixed) == FFI_OK);
+
+  /* The fixed part is filled in once.  */
+  atypes[0] = &ffi_type_pointer;
+  values[0] = &fmt;
+
+  for (i = 0; i < sizeof (fmts) / sizeof (fmts[0]); i++)
+    {
+      fmt = fmts[i];
+      expect = 0;
+      for (j = 0, n = 1; fmt[j]; j++, n++)
+	{
+	  switch (fmt[j])
+	    {
+	    case 'i':
+	      atypes[n] = &ffi_type_sint;
+	      ints[n] = n;
+	      values[n] = &ints[n];
+	      expect += n;
+	      break;
+	    case 'd':
+	      atypes[n] = &ffi_type_double;
+	      doubles[n] = n + 0.5;
+	      values[n] = &doubles[n];
+	      expect += n + 0.5;
+	      break;
+	    case 'l':
+	      atypes[n] = &ffi_type_slong;
+	      longs[n] = 100 * n;
+	      values[n] = &longs[n];
+	      expect += 100 * n;
+	      break;
+	    case 'p':
+	      atypes[n] = &pair_type;
+	      pairs[n].a = n;
+	      pairs[n].b = -2 * (int) n;
+	      values[n] = &pairs[n];
+	      expect -= n;
+	      break;
+	    }
+	}
+
+      CHECK(ffi_prep_cif_var_tail (&cif, &tmpl, n, atypes) == FFI_OK);
+      CHECK(cif.nargs == n);
+      CHECK(cif.arg_types == atypes);
+
+      /* The result matches preparing the whole cif.  */
+      CHECK(ffi_prep_cif_var (&ref, FFI_DEFAULT_ABI, 1, n, &ffi_type_double,
+			      atypes) == FFI_OK);
+      CHECK(cif.bytes == ref.bytes);
+      CHECK(cif.flags == ref.flags);
+
+      ffi_call (&cif, FFI_FN(sum_fn), &res, values);
+      printf ("\"%s\": %g\n", fmt, res);
+      CHECK(res == expect);
+    }
+
+  CHECK(ffi_prep_cif_var_tail (&cif, &tmpl, 0, atypes) == FFI_BAD_TYPEDEF);
+
+  exit(0);
+}
@@ -0,0 +1,107 @@
+/* Area:	ffi_call
+   Purpose:	Check FFI_WIN64 calls of ms_abi functions, including more
+		arguments than fit in the precomputed copy plan.
+   Limitations:	x86-64 only.
+   PR:		none.
+   Originator:	libffi  */
+
+/* { dg-do run { target { x86_64-*-* && lp64 } } } */
+
+#include "ffitest.h"
+
+typedef struct { unsigned char a; } s1_t;
+typedef struct { unsigned char a, b; } s2_t;
+typedef struct { unsigned short a, b; } s4_t;
+typedef struct { int a; float b; } s8_t;
+typedef struct { unsigned char a, b, c; } s3_t;
+typedef struct { double a, b, c; } s24_t;
+
+static double __MSABI__
+mixed (signed char c, short s, int i, long long ll,
+       float f, double d, s1_t s1, s2_t s2, s4_t s4, s8_t s8,
+       s3_t s3, s24_t s24)
+{
+  return c + s + i + ll + f + d + s1.a + s2.a + s2.b + s4.a + s4.b
+    + s8.a + s8.b + s3.a + s3.b + s3.c + s24.a + s24.b + s24.c;
+}
+
+static s24_t __MSABI__
+ret_big (float f, int i, double d)
+{
+  s24_t r;
+
+  r.a = f;
+  r.b = i;
+  r.c = d;
+  return r;
+}
+
+static ffi_type *s1_elts[] = { &ffi_type_uchar, NULL };
+static ffi_type *s2_elts[] = { &ffi_type_uchar, &ffi_type_uchar, NULL };
+static ffi_type *s4_elts[] = { &ffi_type_ushort, &ffi_type_ushort, NULL };
+static ffi_type *s8_elts[] = { &ffi_type_sint, &ffi_type_float, NULL };
+static ffi_type *s3_elts[] = { &ffi_type_uchar, &ffi_type_uchar,
+			       &ffi_type_uchar, NULL };
+static ffi_type *s24_elts[] = { &ffi_type_double, &ffi_type_double,
+				&ffi_type_double, NULL };
+
+static ffi_type s1_type = { 0, 0, FFI_TYPE_STRUCT, s1_elts };
+static ffi_type s2_type = { 0, 0, FFI_TYPE_STRUCT, s2_elts };
+static ffi_type s4_type = { 0, 0, FFI_TYPE_STRUCT, s4_elts };
+static ffi_type s8_type = { 0, 0, FFI_TYPE_STRUCT, s8_elts };
+static ffi_type s3_type = { 0, 0, FFI_TYPE_STRUCT, s3_elts };
+static ffi_type s24_type = { 0, 0, FFI_TYPE_STRUCT, s24_elts };
+
+int main (void)
+{
+  ffi_cif cif;
+  ffi_type *args[12];
+  void *values[12];
+  signed char c = -3;
+  short s = 300;
+  int i = -70000;
+  long long ll = 1LL << 40;
+  float f = 1.5f;
+  double d = 2.25;
+  s1_t s1 = { 7 };
+  s2_t s2 = { 8, 9 };
+  s4_t s4 = { 1000, 2000 };
+  s8_t s8 = { -5, 0.5f };
+  s3_t s3 = { 1, 2, 3 };
+  s24_t s24 = { 10.0, 20.0, 30.0 };
+  s24_t big;
+  double res;
+
+  args[0] = &ffi_type_schar;	values[0] = &c;
+  args[1] = &ffi_type_sshort;	values[1] = &s;
+  args[2] = &ffi_type_sint;	values[2] = &i;
+  args[3] = &ffi_type_sint64;	values[3] = &ll;
+  args[4] = &ffi_type_float;	values[4] = &f;
+  args[5] = &ffi_type_double;	values[5] = &d;
+  args[6] = &s1_type;		values[6] = &s1;
+  args[7] = &s2_type;		values[7] = &s2;
+  args[8] = &s4_type;		values[8] = &s4;
+  args[9] = &s8_type;		values[9] = &s8;
+  args[10] = &s3_type;		values[10] = &s3;
+  args[11] = &s24_type;		values[11] = &s24;
+
+  CHECK(ffi_prep_cif(&cif, FFI_WIN64, 12, &ffi_type_double, args)
+	== FFI_OK);
+  res = 0;
+  ffi_call(&cif, FFI_FN(mixed), &res, values);
+  printf("mixed: %g\n", res);
+  CHECK(res == mixed (c, s, i, ll, f, d, s1, s2, s4, s8, s3, s24));
+
+  /* A struct return takes the first register, shifting every
+     argument down by one slot.  */
+  args[0] = &ffi_type_float;	values[0] = &f;
+  args[1] = &ffi_type_sint;	values[1] = &i;
+  args[2] = &ffi_type_double;	values[2] = &d;
+  CHECK(ffi_prep_cif(&cif, FFI_WIN64, 3, &s24_type, args) == FFI_OK);
+  memset (&big, 0, sizeof (big));
+  ffi_call(&cif, FFI_FN(ret_big), &big, values);
+  printf("ret_big: %g %g %g\n", big.a, big.b, big.c);
+  CHECK(big.a == f && big.b == i && big.c == d);
+
+  exit(0);
+}
@@ -0,0 +1,80 @@
+/* Area:	closure_call
+   Purpose:	Check FFI_WIN64 closures called through ms_abi pointers.
+   Limitations:	x86-64 only.
+   PR:		none.
+   Originator:	libffi  */
+
+/* { dg-do run { target { x86_64-*-* && lp64 } } } */
+
+#include "ffitest.h"
+
+typedef struct { unsigned char a, b; } s2_t;
+typedef struct { unsigned char a, b, c; } s3_t;
+
+typedef double (__MSABI__ *mixed_fn) (float, signed char, double, short,
+				      s2_t, s3_t, int, long long,
+				      float, double);
+
+static void
+mixed_fn_gn (ffi_cif *cif __UNUSED__, void *resp, void **args,
+	     void *userdata __UNUSED__)
+{
+  s2_t s2 = *(s2_t *) args[4];
+  s3_t s3 = *(s3_t *) args[5];
+
+  *(double *) resp = *(float *) args[0]
+    + *(signed char *) args[1]
+    + *(double *) args[2]
+    + *(short *) args[3]
+    + s2.a + s2.b + s3.a + s3.b + s3.c
+    + *(int *) args[6]
+    + *(long long *) args[7]
+    + *(float *) args[8]
+    + *(double *) args[9];
+}
+
+static ffi_type *s2_elts[] = { &ffi_type_uchar, &ffi_type_uchar, NULL };
+static ffi_type *s3_elts[] = { &ffi_type_uchar, &ffi_type_uchar,
+			       &ffi_type_uchar, NULL };
+static ffi_type s2_type = { 0, 0, FFI_TYPE_STRUCT, s2_elts };
+static ffi_type s3_type = { 0, 0, FFI_TYPE_STRUCT, s3_elts };
+
+int main (void)
+{
+  ffi_cif cif;
+  ffi_type *args[10];
+  void *code;
+  ffi_closure *pcl;
+  s2_t s2 = { 4, 5 };
+  s3_t s3 = { 6, 7, 8 };
+  double res;
+
+  args[0] = &ffi_type_float;
+  args[1] = &ffi_type_schar;
+  args[2] = &ffi_type_double;
+  args[3] = &ffi_type_sshort;
+  args[4] = &s2_type;
+  args[5] = &s3_type;
+  args[6] = &ffi_type_sint;
+  args[7] = &ffi_type_sint64;
+  args[8] = &ffi_type_float;
+  args[9] = &ffi_type_double;
+
+  pcl = ffi_closure_alloc(sizeof(ffi_closure), &code);
+  CHECK(pcl != NULL);
+
+  CHECK(ffi_prep_cif(&cif, FFI_WIN64, 10, &ffi_type_double, args)
+	== FFI_OK);
+  CHECK(ffi_prep_closure_loc(pcl, &cif, mixed_fn_gn, NULL, code)
+	== FFI_OK);
+
+  res = ((mixed_fn) code) (1.5f, -2, 3.25, 400, s2, s3, -60000,
+			   1LL << 35, 0.25f, 8.5);
+  printf("res: %g\n", res);
+  CHECK(res == 1.5 - 2 + 3.25 + 400 + 4 + 5 + 6 + 7 + 8 - 60000
+	+ (double) (1LL << 35) + 0.25 + 8.5);
+
+  ffi_closure_free(pcl);
+
+  exit(0);
+}
@@ -0,0 +1,105 @@
+/* Area:	ffi_call
+   Purpose:	Check half-precision and bfloat16 arguments and return values.
+   Limitations:	Needs a compiler that supports _Float16 (and __bf16 for
+		the bfloat16 part).
+   PR:		none.
+   Originator:	libffi  */
+
+/* { dg-do run } */
+#include "ffitest.h"
+
+#ifdef __FLT16_MANT_DIG__
+typedef struct { _Float16 a, b, c; } h3;
+
+static _Float16
+fma_f16 (_Float16 a, double d, _Float16 b, int i, _Float16 c)
+{
+  return a * b + c + (_Float16) d + (_Float16) i;
+}
+
+static h3
+scale_h3 (h3 s, _Float16 k)
+{
+  h3 r = { s.a * k, s.b * k, s.c * k };
+  return r;
+}
+#endif
+
+#ifdef __BFLT16_MANT_DIG__
+static __bf16
+add_bf16 (__bf16 a, float f, __bf16 b)
+{
+  return (__bf16) ((float) a + (float) b + f);
+}
+#endif
+
+int main (void)
+{
+  ffi_cif cif;
+  ffi_type *args[5];
+  void *values[5];
+#ifdef __FLT16_MANT_DIG__
+  ffi_type *h3_elts[4];
+  ffi_type h3_type;
+  _Float16 a = 1.5, b = 2, c = 0.25, k = 4, r;
+  double d = 3;
+  int i = 10;
+  h3 s = { 1, 2, 3 }, hr;
+
+  args[0] = &ffi_type_float16;
+  args[1] = &ffi_type_double;
+  args[2] = &ffi_type_float16;
+  args[3] = &ffi_type_sint;
+  args[4] = &ffi_type_float16;
+  values[0] = &a;
+  values[1] = &d;
+  values[2] = &b;
+  values[3] = &i;
+  values[4] = &c;
+
+  CHECK(ffi_prep_cif(&cif, FFI_DEFAULT_ABI, 5, &ffi_type_float16, args)
+	== FFI_OK);
+  ffi_call(&cif, FFI_FN(fma_f16), &r, values);
+  printf ("%g\n", (double) r);
+  CHECK(r == (_Float16) 16.25);
+
+  /* A homogeneous aggregate of three halves.  */
+  h3_elts[0] = h3_elts[1] = h3_elts[2] = &ffi_type_float16;
+  h3_elts[3] = NULL;
+  h3_type.size = h3_type.alignment = 0;
+  h3_type.type = FFI_TYPE_STRUCT;
+  h3_type.elements = h3_elts;
+
+  args[0] = &h3_type;
+  args[1] = &ffi_type_float16;
+  values[0] = &s;
+  values[1] = &k;
+
+  CHECK(ffi_prep_cif(&cif, FFI_DEFAULT_ABI, 2, &h3_type, args) == FFI_OK);
+  ffi_call(&cif, FFI_FN(scale_h3), &hr, values);
+  printf ("%g %g %g\n", (double) hr.a, (double) hr.b, (double) hr.c);
+  CHECK(hr.a == 4 && hr.b == 8 && hr.c == 12);
+#endif
+
+#ifdef __BFLT16_MANT_DIG__
+  {
+    __bf16 x = 1.5, y = 2, z;
+    float f = 0.5;
+
+    args[0] = &ffi_type_bfloat16;
+    args[1] = &ffi_type_float;
+    args[2] = &ffi_type_bfloat16;
+    values[0] = &x;
+    values[1] = &f;
+    values[2] = &y;
+
+    CHECK(ffi_prep_cif(&cif, FFI_DEFAULT_ABI, 3, &ffi_type_bfloat16, args)
+	  == FFI_OK);
+    ffi_call(&cif, FFI_FN(add_bf16), &z, values);
+    printf ("%g\n", (double) (float) z);
+    CHECK((float) z == 4);
+  }
+#endif
+
+  exit(0);
+}
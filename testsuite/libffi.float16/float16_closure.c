@@ -0,0 +1,85 @@
+/* Area:	closure_call
+   Purpose:	Check half-precision arguments and return values of closures.
+   Limitations:	Needs a compiler that supports _Float16.
+   PR:		none.
+   Originator:	libffi  */
+
+/* { dg-do run } */
+#include "ffitest.h"
+
+#ifdef __FLT16_MANT_DIG__
+typedef struct { _Float16 a, b, c; } h3;
+
+static void
+cls_f16_fn (ffi_cif *cif __UNUSED__, void *resp, void **args,
+	    void *userdata __UNUSED__)
+{
+  _Float16 a = *(_Float16 *) args[0];
+  double d = *(double *) args[1];
+  _Float16 b = *(_Float16 *) args[2];
+  int i = *(int *) args[3];
+  _Float16 c = *(_Float16 *) args[4];
+
+  *(_Float16 *) resp = a * b + c + (_Float16) d + (_Float16) i;
+}
+
+static void
+cls_h3_fn (ffi_cif *cif __UNUSED__, void *resp, void **args,
+	   void *userdata __UNUSED__)
+{
+  h3 s = *(h3 *) args[0];
+  _Float16 k = *(_Float16 *) args[1];
+  h3 r = { s.a * k, s.b * k, s.c * k };
+
+  *(h3 *) resp = r;
+}
+
+typedef _Float16 (*cls_f16) (_Float16, double, _Float16, int, _Float16);
+typedef h3 (*cls_h3) (h3, _Float16);
+#endif
+
+int main (void)
+{
+#ifdef __FLT16_MANT_DIG__
+  ffi_cif cif;
+  void *code;
+  ffi_closure *pcl = ffi_closure_alloc (sizeof (ffi_closure), &code);
+  ffi_type *args[5], *h3_elts[4];
+  ffi_type h3_type;
+  _Float16 r;
+  h3 s = { 1, 2, 3 }, hr;
+
+  args[0] = &ffi_type_float16;
+  args[1] = &ffi_type_double;
+  args[2] = &ffi_type_float16;
+  args[3] = &ffi_type_sint;
+  args[4] = &ffi_type_float16;
+
+  CHECK(ffi_prep_cif(&cif, FFI_DEFAULT_ABI, 5, &ffi_type_float16, args)
+	== FFI_OK);
+  CHECK(ffi_prep_closure_loc(pcl, &cif, cls_f16_fn, NULL, code) == FFI_OK);
+
+  r = ((cls_f16) code) (1.5, 3, 2, 10, 0.25);
+  printf ("%g\n", (double) r);
+  CHECK(r == (_Float16) 16.25);
+
+  h3_elts[0] = h3_elts[1] = h3_elts[2] = &ffi_type_float16;
+  h3_elts[3] = NULL;
+  h3_type.size = h3_type.alignment = 0;
+  h3_type.type = FFI_TYPE_STRUCT;
+  h3_type.elements = h3_elts;
+
+  args[0] = &h3_type;
+  args[1] = &ffi_type_float16;
+
+  CHECK(ffi_prep_cif(&cif, FFI_DEFAULT_ABI, 2, &h3_type, args) == FFI_OK);
+  CHECK(ffi_prep_closure_loc(pcl, &cif, cls_h3_fn, NULL, code) == FFI_OK);
+
+  hr = ((cls_h3) code) (s, 4);
+  printf ("%g %g %g\n", (double) hr.a, (double) hr.b, (double) hr.c);
+  CHECK(hr.a == 4 && hr.b == 8 && hr.c == 12);
+
+  ffi_closure_free (pcl);
+#endif
+  exit(0);
+}
@@ -0,0 +1,98 @@
+/* Area:	ffi_call
+   Purpose:	Check that small structs returned in a single register,
+		a 3-byte one and a lone _Float16, write only their own
+		size into the return buffer.
+   Limitations:	The _Float16 part needs a compiler that supports it.
+   PR:		none.
+   Originator:	libffi  */
+
+/* { dg-do run } */
+#include "ffitest.h"
+
+typedef struct { unsigned char a, b, c; } c3;
+
+static c3
+make_c3 (int x)
+{
+  c3 r = { x, x + 1, x + 2 };
+  return r;
+}
+
+#ifdef __FLT16_MANT_DIG__
+typedef struct { _Float16 h; } h1;
+
+static h1
+make_h1 (_Float16 x)
+{
+  h1 r = { x * 2 };
+  return r;
+}
+#endif
+
+/* The result followed by bytes that must not be written.  */
+#define GUARD 32
+
+int main (void)
+{
+  ffi_cif cif;
+  ffi_type *args[1];
+  void *values[1];
+  ffi_type c3_type, *c3_elts[4];
+  struct { c3 r; unsigned char guard[GUARD]; } cr;
+  int x = 7, i;
+#ifdef __FLT16_MANT_DIG__
+  ffi_type h1_type, *h1_elts[2];
+  struct { h1 r; unsigned char guard[GUARD]; } hr;
+  _Float16 h = 1.25;
+#endif
+#ifdef FFI_TARGET_HAS_VECTOR_TYPE
+  ffi_type v4df_type, *d4_elts[5];
+  ffi_cif vcif;
+
+  /* Classify a 256-bit vector return first, so that a stale
+     classification left on the stack would be picked up below.  */
+  d4_elts[0] = d4_elts[1] = d4_elts[2] = d4_elts[3] = &ffi_type_double;
+  d4_elts[4] = NULL;
+  v4df_type.size = v4df_type.alignment = 0;
+  v4df_type.type = FFI_TYPE_VECTOR;
+  v4df_type.elements = d4_elts;
+  ffi_prep_cif (&vcif, FFI_DEFAULT_ABI, 0, &v4df_type, NULL);
+#endif
+
+  c3_type.size = c3_type.alignment = 0;
+  c3_type.type = FFI_TYPE_STRUCT;
+  c3_type.elements = c3_elts;
+  c3_elts[0] = c3_elts[1] = c3_elts[2] = &ffi_type_uchar;
+  c3_elts[3] = NULL;
+
+  args[0] = &ffi_type_sint;
+  values[0] = &x;
+  CHECK(ffi_prep_cif (&cif, FFI_DEFAULT_ABI, 1, &c3_type, args) == FFI_OK);
+  memset (&cr, 0x5a, sizeof (cr));
+  ffi_call (&cif, FFI_FN(make_c3), &cr.r, values);
+  CHECK(cr.r.a == 7 && cr.r.b == 8 && cr.r.c == 9);
+  for (i = 0; i < GUARD; i++)
+    CHECK(cr.guard[i] == 0x5a);
+
+#ifdef __FLT16_MANT_DIG__
+  h1_type.size = h1_type.alignment = 0;
+  h1_type.type = FFI_TYPE_STRUCT;
+  h1_type.elements = h1_elts;
+  h1_elts[0] = &ffi_type_float16;
+  h1_elts[1] = NULL;
+
+#ifdef FFI_TARGET_HAS_VECTOR_TYPE
+  ffi_prep_cif (&vcif, FFI_DEFAULT_ABI, 0, &v4df_type, NULL);
+#endif
+  args[0] = &ffi_type_float16;
+  values[0] = &h;
+  CHECK(ffi_prep_cif (&cif, FFI_DEFAULT_ABI, 1, &h1_type, args) == FFI_OK);
+  memset (&hr, 0x5a, sizeof (hr));
+  ffi_call (&cif, FFI_FN(make_h1), &hr.r, values);
+  CHECK(hr.r.h == 2.5);
+  for (i = 0; i < GUARD; i++)
+    CHECK(hr.guard[i] == 0x5a);
+#endif
+
+  exit(0);
+}
@@ -0,0 +1,72 @@
+/* Area:	ffi_call
+   Purpose:	Check that a struct ending in a _Float16 is copied into
+		registers without reading past its end.
+   Limitations:	Needs a compiler that supports _Float16, and mmap.
+   PR:		none.
+   Originator:	libffi  */
+
+/* { dg-do run } */
+#include "ffitest.h"
+
+#if defined __FLT16_MANT_DIG__ && (defined __unix__ || defined __APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+
+typedef struct { float a, b; _Float16 c; } ffh;
+
+static float
+sum_ffh (ffh s)
+{
+  return s.a + s.b + (float) s.c;
+}
+
+int main (void)
+{
+  ffi_cif cif;
+  ffi_type *args[1];
+  void *values[1];
+  ffi_type ffh_type, *ffh_elts[4];
+  long page = sysconf (_SC_PAGESIZE);
+  char *mem;
+  ffh *s;
+  float r;
+
+  /* Put the struct's last byte at the end of a page that is followed
+     by an inaccessible one.  */
+  mem = mmap (NULL, 2 * page, PROT_READ | PROT_WRITE,
+	      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  CHECK(mem != MAP_FAILED);
+  CHECK(mprotect (mem + page, page, PROT_NONE) == 0);
+  s = (ffh *) (mem + page - sizeof (ffh));
+  s->a = 1.5f;
+  s->b = 2.25f;
+  s->c = 0.5;
+
+  ffh_type.size = ffh_type.alignment = 0;
+  ffh_type.type = FFI_TYPE_STRUCT;
+  ffh_type.elements = ffh_elts;
+  ffh_elts[0] = &ffi_type_float;
+  ffh_elts[1] = &ffi_type_float;
+  ffh_elts[2] = &ffi_type_float16;
+  ffh_elts[3] = NULL;
+
+  args[0] = &ffh_type;
+  values[0] = s;
+  CHECK(ffi_prep_cif (&cif, FFI_DEFAULT_ABI, 1, &ffi_type_float, args)
+	== FFI_OK);
+  CHECK(ffh_type.size == sizeof (ffh));
+  ffi_call (&cif, FFI_FN(sum_ffh), &r, values);
+  CHECK(r == 4.25f);
+
+  munmap (mem, 2 * page);
+  exit(0);
+}
+
+#else
+
+int main (void)
+{
+  exit(0);
+}
+
+#endif
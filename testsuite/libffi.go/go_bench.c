@@ -0,0 +1,128 @@
+/* Area:	ffi_call_go, ffi_prep_go_closure
+   Purpose:	Time Go closure round trips with scalar and struct
+		arguments, and check their results.
+   Limitations:	none.
+   PR:		none.
+   Originator:	libffi  */
+
+/* { dg-do run } */
+
+#include "ffitest.h"
+#include <time.h>
+
+#define ROUNDS 200000
+
+struct pair
+{
+  long a;
+  double b;
+};
+
+static void
+scalar_fn (ffi_cif *cif, void *rvalue, void **avalue, void *closure)
+{
+  (void) cif;
+  *(double *) rvalue = *(signed char *) avalue[0]
+		       + *(unsigned short *) avalue[1]
+		       + *(int *) avalue[2]
+		       + *(double *) avalue[3]
+		       + *(float *) avalue[4]
+		       + *(long long *) avalue[5]
+		       + (*(void **) avalue[6] == closure);
+}
+
+static void
+pair_fn (ffi_cif *cif, void *rvalue, void **avalue, void *closure)
+{
+  struct pair *p = avalue[0];
+
+  (void) cif;
+  *(double *) rvalue = p->a + p->b + *(int *) avalue[1]
+		       + (*(void **) avalue[2] == closure);
+}
+
+static double
+elapsed (clock_t start)
+{
+  return (double) (clock () - start) / CLOCKS_PER_SEC;
+}
+
+int main (void)
+{
+  ffi_cif scalar_cif, pair_cif;
+  ffi_type *scalar_args[7], *pair_args[3];
+  ffi_type pair_type, *pair_elts[3];
+  ffi_go_closure scalar_cl, pair_cl;
+  void *values[7];
+  signed char c = -3;
+  unsigned short us = 40000;
+  int i = 7;
+  double d = 0.25;
+  float f = 0.5f;
+  long long ll = 1000000;
+  void *p;
+  struct pair pr = { 11, 0.125 };
+  double res, sum;
+  clock_t start;
+  long n;
+
+  scalar_args[0] = &ffi_type_schar;
+  scalar_args[1] = &ffi_type_ushort;
+  scalar_args[2] = &ffi_type_sint;
+  scalar_args[3] = &ffi_type_double;
+  scalar_args[4] = &ffi_type_float;
+  scalar_args[5] = &ffi_type_sint64;
+  scalar_args[6] = &ffi_type_pointer;
+  CHECK(ffi_prep_cif (&scalar_cif, ABI_NUM, 7, &ffi_type_double,
+		      scalar_args) == FFI_OK);
+  CHECK(ffi_prep_go_closure (&scalar_cl, &scalar_cif, scalar_fn) == FFI_OK);
+
+  pair_type.size = pair_type.alignment = 0;
+  pair_type.type = FFI_TYPE_STRUCT;
+  pair_type.elements = pair_elts;
+  pair_elts[0] = &ffi_type_slong;
+  pair_elts[1] = &ffi_type_double;
+  pair_elts[2] = NULL;
+  pair_args[0] = &pair_type;
+  pair_args[1] = &ffi_type_sint;
+  pair_args[2] = &ffi_type_pointer;
+  CHECK(ffi_prep_cif (&pair_cif, ABI_NUM, 3, &ffi_type_double,
+		      pair_args) == FFI_OK);
+  CHECK(ffi_prep_go_closure (&pair_cl, &pair_cif, pair_fn) == FFI_OK);
+
+  values[0] = &c;
+  values[1] = &us;
+  values[2] = &i;
+  values[3] = &d;
+  values[4] = &f;
+  values[5] = &ll;
+  values[6] = &p;
+  p = &scalar_cl;
+  start = clock ();
+  for (n = 0, sum = 0; n < ROUNDS; n++)
+    {
+      ffi_call_go (&scalar_cif, FFI_FN(*(void **) &scalar_cl), &res, values,
+		   &scalar_cl);
+      sum += res;
+    }
+  printf ("scalar: %d rounds in %.3fs\n", ROUNDS, elapsed (start));
+  CHECK(res == 1040005.75);
+  CHECK(sum == res * ROUNDS);
+
+  values[0] = &pr;
+  values[1] = &i;
+  values[2] = &p;
+  p = &pair_cl;
+  start = clock ();
+  for (n = 0, sum = 0; n < ROUNDS; n++)
+    {
+      ffi_call_go (&pair_cif, FFI_FN(*(void **) &pair_cl), &res, values,
+		   &pair_cl);
+      sum += res;
+    }
+  printf ("struct: %d rounds in %.3fs\n", ROUNDS, elapsed (start));
+  CHECK(res == 19.125);
+  CHECK(sum == res * ROUNDS);
+
+  exit (0);
+}
@@ -0,0 +1,73 @@
+/* Area:	ffi_call
+   Purpose:	Check 128-bit integer arguments and return values.
+   Limitations:	none.
+   PR:		none.
+   Originator:	libffi  */
+
+/* { dg-do run } */
+#include "ffitest.h"
+
+#define HI(x) ((unsigned long long) ((unsigned __int128) (x) >> 64))
+#define LO(x) ((unsigned long long) (x))
+
+static __int128
+sum_int128 (int a, __int128 b, unsigned __int128 c, long d)
+{
+  return a + b + (__int128) c + d;
+}
+
+static unsigned __int128
+last_uint128 (long a, long b, long c, long d, long e,
+	      unsigned __int128 f, unsigned __int128 g)
+{
+  return (f << 1) + g + a + b + c + d + e;
+}
+
+int main (void)
+{
+  ffi_cif cif;
+  ffi_type *args[7];
+  void *values[7];
+  int a = 1;
+  long l[5] = { 1, 2, 3, 4, 5 };
+  __int128 b = -((__int128) 0x0123456789abcdefLL << 64), r;
+  unsigned __int128 c = ((unsigned __int128) 1 << 100) + 7, g, u;
+
+  /* The 128-bit argument follows a single int, so it needs an
+     even-numbered register pair on some targets.  */
+  args[0] = &ffi_type_sint;
+  args[1] = &ffi_type_sint128;
+  args[2] = &ffi_type_uint128;
+  args[3] = &ffi_type_slong;
+  values[0] = &a;
+  values[1] = &b;
+  values[2] = &c;
+  values[3] = &l[4];
+
+  CHECK(ffi_prep_cif(&cif, FFI_DEFAULT_ABI, 4, &ffi_type_sint128, args)
+	== FFI_OK);
+  ffi_call(&cif, FFI_FN(sum_int128), &r, values);
+  printf ("%llx %llx\n", HI(r), LO(r));
+  CHECK(r == sum_int128 (a, b, c, l[4]));
+
+  /* Two 128-bit arguments after five longs: the first no longer
+     fits in registers and the rest go on the stack.  */
+  g = ~(unsigned __int128) 0 / 3;
+  args[0] = args[1] = args[2] = args[3] = args[4] = &ffi_type_slong;
+  args[5] = args[6] = &ffi_type_uint128;
+  values[0] = &l[0];
+  values[1] = &l[1];
+  values[2] = &l[2];
+  values[3] = &l[3];
+  values[4] = &l[4];
+  values[5] = &c;
+  values[6] = &g;
+
+  CHECK(ffi_prep_cif(&cif, FFI_DEFAULT_ABI, 7, &ffi_type_uint128, args)
+	== FFI_OK);
+  ffi_call(&cif, FFI_FN(last_uint128), &u, values);
+  printf ("%llx %llx\n", HI(u), LO(u));
+  CHECK(u == last_uint128 (1, 2, 3, 4, 5, c, g));
+
+  exit(0);
+}
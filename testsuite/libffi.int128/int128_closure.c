@@ -0,0 +1,52 @@
+/* Area:	closure_call
+   Purpose:	Check 128-bit integer arguments and return values of closures.
+   Limitations:	none.
+   PR:		none.
+   Originator:	libffi  */
+
+/* { dg-do run } */
+#include "ffitest.h"
+
+static void
+cls_int128_fn (ffi_cif *cif __UNUSED__, void *resp, void **args,
+	       void *userdata __UNUSED__)
+{
+  int a = *(int *) args[0];
+  __int128 b = *(__int128 *) args[1];
+  unsigned __int128 c = *(unsigned __int128 *) args[2];
+  long d = *(long *) args[3];
+  __int128 e = *(__int128 *) args[4];
+
+  *(__int128 *) resp = a + b + (__int128) c + d + e;
+}
+
+typedef __int128 (*cls_int128) (int, __int128, unsigned __int128, long,
+				__int128);
+
+int main (void)
+{
+  ffi_cif cif;
+  void *code;
+  ffi_closure *pcl = ffi_closure_alloc (sizeof (ffi_closure), &code);
+  ffi_type *args[5];
+  __int128 b = -((__int128) 0x0123456789abcdefLL << 64), e = 3, r;
+  unsigned __int128 c = ((unsigned __int128) 1 << 100) + 7;
+
+  args[0] = &ffi_type_sint;
+  args[1] = &ffi_type_sint128;
+  args[2] = &ffi_type_uint128;
+  args[3] = &ffi_type_slong;
+  args[4] = &ffi_type_sint128;
+
+  CHECK(ffi_prep_cif(&cif, FFI_DEFAULT_ABI, 5, &ffi_type_sint128, args)
+	== FFI_OK);
+  CHECK(ffi_prep_closure_loc(pcl, &cif, cls_int128_fn, NULL, code) == FFI_OK);
+
+  r = ((cls_int128) code) (1, b, c, 5, e);
+  printf ("%llx %llx\n", (unsigned long long) ((unsigned __int128) r >> 64),
+	  (unsigned long long) r);
+  CHECK(r == 1 + b + (__int128) c + 5 + e);
+
+  ffi_closure_free (pcl);
+  exit(0);
+}
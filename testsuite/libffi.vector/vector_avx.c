@@ -0,0 +1,69 @@
+/* Area:	ffi_call, closure_call
+   Purpose:	Check 256-bit vectors passed and returned in ymm registers.
+   Limitations:	x86-64 only; skipped at run time without AVX.
+   PR:		none.
+   Originator:	libffi  */
+
+/* { dg-do run { target x86_64-*-* } } */
+/* { dg-options "-mavx" { target x86_64-*-* } } */
+#include "ffitest.h"
+
+typedef double v4df __attribute__ ((vector_size (32)));
+
+static v4df __attribute__ ((noinline))
+madd (v4df a, double s, v4df b)
+{
+  return a * s + b;
+}
+
+static void
+cls_madd_fn (ffi_cif *cif __UNUSED__, void *resp, void **args,
+	     void *userdata __UNUSED__)
+{
+  *(v4df *) resp = madd (*(v4df *) args[0], *(double *) args[1],
+			 *(v4df *) args[2]);
+}
+
+typedef v4df (*cls_madd) (v4df, double, v4df);
+
+int main (void)
+{
+  ffi_cif cif;
+  void *code;
+  ffi_closure *pcl;
+  ffi_type *d4_elts[5];
+  ffi_type v4df_type;
+  ffi_type *args[3];
+  void *values[3];
+  v4df a = { 1, 2, 3, 4 }, b = { 0.5, 0.25, 0.125, 0.0625 }, r;
+  double s = 3;
+
+  if (!__builtin_cpu_supports ("avx"))
+    exit(0);
+
+  d4_elts[0] = d4_elts[1] = d4_elts[2] = d4_elts[3] = &ffi_type_double;
+  d4_elts[4] = NULL;
+  v4df_type.size = v4df_type.alignment = 0;
+  v4df_type.type = FFI_TYPE_VECTOR;
+  v4df_type.elements = d4_elts;
+
+  args[0] = &v4df_type;
+  args[1] = &ffi_type_double;
+  args[2] = &v4df_type;
+  values[0] = &a;
+  values[1] = &s;
+  values[2] = &b;
+
+  CHECK(ffi_prep_cif(&cif, FFI_DEFAULT_ABI, 3, &v4df_type, args) == FFI_OK);
+  CHECK(v4df_type.size == 32 && v4df_type.alignment == 32);
+  ffi_call(&cif, FFI_FN(madd), &r, values);
+  CHECK(r[0] == 3.5 && r[1] == 6.25 && r[2] == 9.125 && r[3] == 12.0625);
+
+  pcl = ffi_closure_alloc (sizeof (ffi_closure), &code);
+  CHECK(ffi_prep_closure_loc(pcl, &cif, cls_madd_fn, NULL, code) == FFI_OK);
+  r = ((cls_madd) code) (b, 2, a);
+  CHECK(r[0] == 2 && r[1] == 2.5 && r[2] == 3.25 && r[3] == 4.125);
+
+  ffi_closure_free (pcl);
+  exit(0);
+}
@@ -0,0 +1,101 @@
+/* Area:	ffi_call, closure_call
+   Purpose:	Check a 256-bit vector passed on the stack once ymm0-7
+		are taken, after an integer argument.
+   Limitations:	x86-64 only; skipped at run time without AVX.
+   PR:		none.
+   Originator:	libffi  */
+
+/* { dg-do run { target x86_64-*-* } } */
+/* { dg-options "-mavx" { target x86_64-*-* } } */
+#include "ffitest.h"
+
+typedef double v4df __attribute__ ((vector_size (32)));
+
+static v4df __attribute__ ((noinline))
+sum9 (v4df a0, v4df a1, v4df a2, v4df a3, v4df a4, v4df a5, v4df a6,
+      v4df a7, long l, v4df a8)
+{
+  /* The stack copy of A8 must be aligned as its type requires.  */
+  CHECK(((uintptr_t) &a8 & 31) == 0);
+  return a0 + a1 + a2 + a3 + a4 + a5 + a6 + a7 + a8 * (double) l;
+}
+
+static void
+cls_sum9_fn (ffi_cif *cif __UNUSED__, void *resp, void **args,
+	     void *userdata __UNUSED__)
+{
+  v4df **v = (v4df **) args;
+
+  *(v4df *) resp = sum9 (*v[0], *v[1], *v[2], *v[3], *v[4], *v[5], *v[6],
+			 *v[7], *(long *) args[8], *v[9]);
+}
+
+typedef v4df (*cls_sum9) (v4df, v4df, v4df, v4df, v4df, v4df, v4df, v4df,
+			  long, v4df);
+
+/* Call with the stack moved down by 0, 16, 32 and 48 bytes, so that
+   at least one call leaves the outgoing arguments off a 32-byte
+   boundary unless libffi aligns them.  */
+static void __attribute__ ((noinline))
+call_with_offset (ffi_cif *cif, void **values, int offset)
+{
+  volatile char *pad = __builtin_alloca (offset + 1);
+  v4df r;
+
+  pad[0] = 0;
+  ffi_call (cif, FFI_FN(sum9), &r, values);
+  CHECK(r[0] == 8 + 3 * 9 && r[1] == 16 + 3 * 18
+	&& r[2] == 24 + 3 * 27 && r[3] == 32 + 3 * 36);
+}
+
+int main (void)
+{
+  ffi_cif cif;
+  void *code;
+  ffi_closure *pcl;
+  ffi_type *d4_elts[5];
+  ffi_type v4df_type;
+  ffi_type *args[10];
+  void *values[10];
+  v4df v[9], r;
+  long l = 3;
+  int i;
+
+  if (!__builtin_cpu_supports ("avx"))
+    exit(0);
+
+  d4_elts[0] = d4_elts[1] = d4_elts[2] = d4_elts[3] = &ffi_type_double;
+  d4_elts[4] = NULL;
+  v4df_type.size = v4df_type.alignment = 0;
+  v4df_type.type = FFI_TYPE_VECTOR;
+  v4df_type.elements = d4_elts;
+
+  for (i = 0; i < 9; i++)
+    {
+      v4df one = { 1, 2, 3, 4 };
+      v[i] = one * (double) (i == 8 ? 9 : 1);
+    }
+  for (i = 0; i < 8; i++)
+    {
+      args[i] = &v4df_type;
+      values[i] = &v[i];
+    }
+  args[8] = &ffi_type_slong;
+  values[8] = &l;
+  args[9] = &v4df_type;
+  values[9] = &v[8];
+
+  CHECK(ffi_prep_cif(&cif, FFI_DEFAULT_ABI, 10, &v4df_type, args) == FFI_OK);
+  for (i = 0; i < 4; i++)
+    call_with_offset (&cif, values, i * 16);
+
+  pcl = ffi_closure_alloc (sizeof (ffi_closure), &code);
+  CHECK(ffi_prep_closure_loc(pcl, &cif, cls_sum9_fn, NULL, code) == FFI_OK);
+  r = ((cls_sum9) code) (v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7],
+			 2, v[8]);
+  CHECK(r[0] == 8 + 2 * 9 && r[1] == 16 + 2 * 18
+	&& r[2] == 24 + 2 * 27 && r[3] == 32 + 2 * 36);
+
+  ffi_closure_free (pcl);
+  exit(0);
+}
@@ -0,0 +1,130 @@
+/* Area:	ffi_call
+   Purpose:	Check passing and returning SIMD vectors, including
+		vectors wrapped in structures and vectors passed on the
+		stack once the vector registers run out.
+   Limitations:	none.
+   PR:		none.
+   Originator:	libffi  */
+
+/* { dg-do run } */
+#include "ffitest.h"
+
+typedef float v4sf __attribute__ ((vector_size (16)));
+typedef int v2si __attribute__ ((vector_size (8)));
+
+typedef struct { v4sf v; } wrap;
+
+static v4sf
+scale (v4sf a, float s, v2si b)
+{
+  v4sf r = a * s;
+  r[0] += b[0];
+  r[3] += b[1];
+  return r;
+}
+
+static v2si
+swap (v2si a)
+{
+  v2si r = { a[1], a[0] };
+  return r;
+}
+
+static wrap
+add_wrapped (wrap a, wrap b)
+{
+  wrap r;
+  r.v = a.v + b.v;
+  return r;
+}
+
+static float
+sum9 (v4sf a, v4sf b, v4sf c, v4sf d, v4sf e, v4sf f, v4sf g, v4sf h,
+      double x, v4sf i)
+{
+  v4sf t = a + b + c + d + e + f + g + h + i;
+  return t[0] + t[1] + t[2] + t[3] + (float) x;
+}
+
+int main (void)
+{
+  ffi_cif cif;
+  ffi_type *f4_elts[5], *i2_elts[3], *wrap_elts[2];
+  ffi_type v4sf_type, v2si_type, wrap_type;
+  ffi_type *args[10];
+  void *values[10];
+  v4sf a = { 1, 2, 3, 4 }, vr, vs[9];
+  v2si b = { 10, 20 }, br;
+  wrap wa, wb, wr;
+  float s = 2.0f, fr;
+  double x = 0.5;
+  int i;
+
+  f4_elts[0] = f4_elts[1] = f4_elts[2] = f4_elts[3] = &ffi_type_float;
+  f4_elts[4] = NULL;
+  v4sf_type.size = v4sf_type.alignment = 0;
+  v4sf_type.type = FFI_TYPE_VECTOR;
+  v4sf_type.elements = f4_elts;
+
+  i2_elts[0] = i2_elts[1] = &ffi_type_sint32;
+  i2_elts[2] = NULL;
+  v2si_type.size = v2si_type.alignment = 0;
+  v2si_type.type = FFI_TYPE_VECTOR;
+  v2si_type.elements = i2_elts;
+
+  wrap_elts[0] = &v4sf_type;
+  wrap_elts[1] = NULL;
+  wrap_type.size = wrap_type.alignment = 0;
+  wrap_type.type = FFI_TYPE_STRUCT;
+  wrap_type.elements = wrap_elts;
+
+  args[0] = &v4sf_type;
+  args[1] = &ffi_type_float;
+  args[2] = &v2si_type;
+  values[0] = &a;
+  values[1] = &s;
+  values[2] = &b;
+  CHECK(ffi_prep_cif(&cif, FFI_DEFAULT_ABI, 3, &v4sf_type, args) == FFI_OK);
+  CHECK(v4sf_type.size == 16 && v4sf_type.alignment == 16);
+  CHECK(v2si_type.size == 8 && v2si_type.alignment == 8);
+  ffi_call(&cif, FFI_FN(scale), &vr, values);
+  CHECK(vr[0] == 12 && vr[1] == 4 && vr[2] == 6 && vr[3] == 28);
+
+  CHECK(ffi_prep_cif(&cif, FFI_DEFAULT_ABI, 1, &v2si_type, &args[2]) == FFI_OK);
+  ffi_call(&cif, FFI_FN(swap), &br, &values[2]);
+  CHECK(br[0] == 20 && br[1] == 10);
+
+  wa.v = a;
+  wb.v = vr;
+  args[0] = args[1] = &wrap_type;
+  values[0] = &wa;
+  values[1] = &wb;
+  CHECK(ffi_prep_cif(&cif, FFI_DEFAULT_ABI, 2, &wrap_type, args) == FFI_OK);
+  ffi_call(&cif, FFI_FN(add_wrapped), &wr, values);
+  CHECK(wr.v[0] == 13 && wr.v[1] == 6 && wr.v[2] == 9 && wr.v[3] == 32);
+
+  for (i = 0; i < 9; i++)
+    {
+      v4sf t = { i, i, i, i };
+      vs[i] = t;
+      args[i < 8 ? i : 9] = &v4sf_type;
+      values[i < 8 ? i : 9] = &vs[i];
+    }
+  args[8] = &ffi_type_double;
+  values[8] = &x;
+  CHECK(ffi_prep_cif(&cif, FFI_DEFAULT_ABI, 10, &ffi_type_float, args) == FFI_OK);
+  ffi_call(&cif, FFI_FN(sum9), &fr, values);
+  CHECK(fr == 144.5f);
+
+  /* Lanes must agree, and the total size must be a power of two.  */
+  i2_elts[1] = &ffi_type_uint32;
+  v2si_type.size = 0;
+  CHECK(ffi_prep_cif(&cif, FFI_DEFAULT_ABI, 0, &v2si_type, NULL)
+	== FFI_BAD_TYPEDEF);
+  f4_elts[3] = NULL;
+  v4sf_type.size = 0;
+  CHECK(ffi_prep_cif(&cif, FFI_DEFAULT_ABI, 0, &v4sf_type, NULL)
+	== FFI_BAD_TYPEDEF);
+
+  exit(0);
+}
@@ -0,0 +1,70 @@
+/* Area:	closure_call
+   Purpose:	Check SIMD vector arguments and return values of closures.
+   Limitations:	none.
+   PR:		none.
+   Originator:	libffi  */
+
+/* { dg-do run } */
+#include "ffitest.h"
+
+typedef float v4sf __attribute__ ((vector_size (16)));
+typedef short v4hi __attribute__ ((vector_size (8)));
+
+static void
+cls_vec_fn (ffi_cif *cif __UNUSED__, void *resp, void **args,
+	    void *userdata __UNUSED__)
+{
+  v4sf a = *(v4sf *) args[0];
+  double d = *(double *) args[1];
+  v4hi h = *(v4hi *) args[2];
+  v4sf b = *(v4sf *) args[3];
+  v4sf r;
+
+  r = a + b;
+  r[0] += (float) d;
+  r[1] += h[0];
+  r[2] += h[1];
+  r[3] += h[2] + h[3];
+  *(v4sf *) resp = r;
+}
+
+typedef v4sf (*cls_vec) (v4sf, double, v4hi, v4sf);
+
+int main (void)
+{
+  ffi_cif cif;
+  void *code;
+  ffi_closure *pcl = ffi_closure_alloc (sizeof (ffi_closure), &code);
+  ffi_type *f4_elts[5], *h4_elts[5];
+  ffi_type v4sf_type, v4hi_type;
+  ffi_type *args[4];
+  v4sf a = { 1, 2, 3, 4 }, b = { 10, 20, 30, 40 }, r;
+  v4hi h = { 100, 200, 300, 400 };
+
+  f4_elts[0] = f4_elts[1] = f4_elts[2] = f4_elts[3] = &ffi_type_float;
+  f4_elts[4] = NULL;
+  v4sf_type.size = v4sf_type.alignment = 0;
+  v4sf_type.type = FFI_TYPE_VECTOR;
+  v4sf_type.elements = f4_elts;
+
+  h4_elts[0] = h4_elts[1] = h4_elts[2] = h4_elts[3] = &ffi_type_sint16;
+  h4_elts[4] = NULL;
+  v4hi_type.size = v4hi_type.alignment = 0;
+  v4hi_type.type = FFI_TYPE_VECTOR;
+  v4hi_type.elements = h4_elts;
+
+  args[0] = &v4sf_type;
+  args[1] = &ffi_type_double;
+  args[2] = &v4hi_type;
+  args[3] = &v4sf_type;
+
+  CHECK(ffi_prep_cif(&cif, FFI_DEFAULT_ABI, 4, &v4sf_type, args) == FFI_OK);
+  CHECK(ffi_prep_closure_loc(pcl, &cif, cls_vec_fn, NULL, code) == FFI_OK);
+
+  r = ((cls_vec) code) (a, 0.5, h, b);
+  printf ("%g %g %g %g\n", r[0], r[1], r[2], r[3]);
+  CHECK(r[0] == 11.5f && r[1] == 122 && r[2] == 233 && r[3] == 744);
+
+  ffi_closure_free (pcl);
+  exit(0);
+}